@@ -23,18 +23,31 @@
 #endif
 
 #include "ac3d.h"
+#include "gzipstream.h"
+#include "hash64.h"
 #include "triangleintersects.hpp"
 
+#include <atomic>
 #include <cctype>
 #include <cstdio>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <iomanip>
 #include <map>
-#include <omp.h>
+#include <optional>
 #include <png.h>
 
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
 constexpr std::string_view MATERIAL_token("MATERIAL");
 constexpr std::string_view rgb_token("rgb");
 constexpr std::string_view amb_token("amb");
@@ -154,12 +167,17 @@ bool hasTrailing(const std::istringstream &s)
     return end != pos;
 }
 
+std::string getTrailing(const std::istringstream &s, std::streampos pos)
+{
+    return std::string(s.view().substr(static_cast<size_t>(pos)));
+}
+
 std::string getTrailing(const std::istringstream &s)
 {
     std::streambuf *buf = s.rdbuf();
     const std::streampos pos = buf->pubseekoff(0, std::ios_base::cur, std::ios_base::in);
     buf->pubseekpos(pos, std::ios_base::in);
-    return s.str().substr(pos);
+    return getTrailing(s, pos);
 }
 
 size_t offsetOfToken(const std::istringstream &in, size_t index)
@@ -201,37 +219,212 @@ bool icasecmp(const std::string &l, const std::string_view &r)
 
 } // namespace
 
-void AC3D::showLine(std::istringstream &in) const
+AC3D::~AC3D()
+{
+    waitForTextures();
+    finishDiagnostics();
+}
+
+const std::vector<AC3D::CheckName> &AC3D::checkTable()
+{
+    static const std::vector<CheckName> checks =
+    {
+        { "ambiguous-texture",                 &AC3D::m_ambiguous_texture_count },
+        { "blank-line",                        &AC3D::m_blank_line_count },
+        { "collinear-surface-vertices",        &AC3D::m_collinear_surface_vertices_count },
+        { "different-mat",                     &AC3D::m_different_mat_count },
+        { "different-surf",                    &AC3D::m_different_surf_count },
+        { "different-uv",                      &AC3D::m_different_uv_count },
+        { "duplicate-materials",               &AC3D::m_duplicate_materials_count },
+        { "duplicate-surface-vertices",        &AC3D::m_duplicate_surface_vertices_count },
+        { "duplicate-surfaces",                &AC3D::m_duplicate_surfaces_count },
+        { "duplicate-surfaces-order",          &AC3D::m_duplicate_surfaces_order_count },
+        { "duplicate-surfaces-winding",        &AC3D::m_duplicate_surfaces_winding_count },
+        { "duplicate-texture",                 &AC3D::m_duplicate_texture_count },
+        { "duplicate-triangles",               &AC3D::m_duplicate_triangles_count },
+        { "duplicate-vertices",                &AC3D::m_duplicate_vertices_count },
+        { "empty-object",                      &AC3D::m_empty_object_count },
+        { "extra-object",                      &AC3D::m_extra_object_count },
+        { "extra-uv-coordinates",              &AC3D::m_extra_uv_coordinates_count },
+        { "floating-point",                    &AC3D::m_floating_point_count },
+        { "group-with-geometry",               &AC3D::m_group_with_geometry_count },
+        { "invalid-kids-count",                &AC3D::m_invalid_kids_count_count },
+        { "invalid-material",                  &AC3D::m_invalid_material_count },
+        { "invalid-material-index",            &AC3D::m_invalid_material_index_count },
+        { "invalid-normal",                    &AC3D::m_invalid_normal_count },
+        { "invalid-normal-length",             &AC3D::m_invalid_normal_length_count },
+        { "invalid-numsurf",                   &AC3D::m_invalid_numsurf_count },
+        { "invalid-numvert",                   &AC3D::m_invalid_numvert_count },
+        { "invalid-object-type",               &AC3D::m_invalid_object_type_count },
+        { "invalid-ref-count",                 &AC3D::m_invalid_ref_count_count },
+        { "invalid-ref-vertex-index",          &AC3D::m_invalid_ref_vertex_index_count },
+        { "invalid-refs-count",                &AC3D::m_invalid_refs_count_count },
+        { "invalid-surface-type",              &AC3D::m_invalid_surface_type_count },
+        { "invalid-texture-coordinate",        &AC3D::m_invalid_texture_coordinate_count },
+        { "invalid-token",                     &AC3D::m_invalid_token_count },
+        { "invalid-vertex",                    &AC3D::m_invalid_vertex_count },
+        { "material-after-object",             &AC3D::m_material_after_object_count },
+        { "missing-kids",                      &AC3D::m_missing_kids_count },
+        { "missing-mat",                       &AC3D::m_missing_mat_count },
+        { "missing-normal",                    &AC3D::m_missing_normal_count },
+        { "missing-surfaces",                  &AC3D::m_missing_surfaces_count },
+        { "missing-texture",                   &AC3D::m_missing_texture_count },
+        { "missing-uv-coordinates",            &AC3D::m_missing_uv_coordinates_count },
+        { "missing-vertex",                    &AC3D::m_missing_vertex_count },
+        { "more-surf-than-specified",          &AC3D::m_more_surf_than_specified_count },
+        { "multiple-crease",                   &AC3D::m_multiple_crease_count },
+        { "multiple-data",                     &AC3D::m_multiple_data_count },
+        { "multiple-folded",                   &AC3D::m_multiple_folded_count },
+        { "multiple-hidden",                   &AC3D::m_multiple_hidden_count },
+        { "multiple-loc",                      &AC3D::m_multiple_loc_count },
+        { "multiple-locked",                   &AC3D::m_multiple_locked_count },
+        { "multiple-name",                     &AC3D::m_multiple_name_count },
+        { "multiple-polygon-surface",          &AC3D::m_multiple_polygon_surface_count },
+        { "multiple-rot",                      &AC3D::m_multiple_rot_count },
+        { "multiple-shader",                   &AC3D::m_multiple_shader_count },
+        { "multiple-subdiv",                   &AC3D::m_multiple_subdiv_count },
+        { "multiple-texoff",                   &AC3D::m_multiple_texoff_count },
+        { "multiple-texrep",                   &AC3D::m_multiple_texrep_count },
+        { "multiple-texture",                  &AC3D::m_multiple_texture_count },
+        { "multiple-url",                      &AC3D::m_multiple_url_count },
+        { "multiple-world",                    &AC3D::m_multiple_world_count },
+        { "overlapping-2-sided-surface",       &AC3D::m_overlapping_2_sided_surface_count },
+        { "surface-2-sided-opaque",            &AC3D::m_surface_2_sided_opaque_count },
+        { "surface-no-texture",                &AC3D::m_surface_no_texture_count },
+        { "surface-not-convex",                &AC3D::m_surface_not_convex_count },
+        { "surface-not-coplanar",              &AC3D::m_surface_not_coplanar_count },
+        { "surface-self-intersecting",         &AC3D::m_surface_self_intersecting_count },
+        { "surface-strip-degenerate",          &AC3D::m_surface_strip_degenerate_count },
+        { "surface-strip-duplicate-triangles", &AC3D::m_surface_strip_duplicate_triangles_count },
+        { "surface-strip-hole",                &AC3D::m_surface_strip_hole_count },
+        { "surface-strip-size",                &AC3D::m_surface_strip_size_count },
+        { "surface-zero-area-uv",              &AC3D::m_surface_zero_area_uv_count },
+        { "trailing-text",                     &AC3D::m_trailing_text_count },
+        { "unsupported-version",               &AC3D::m_unsupported_version_count },
+        { "unused-material",                   &AC3D::m_unused_material_count },
+        { "unused-vertex",                     &AC3D::m_unused_vertex_count },
+        { "utf8-bom",                          &AC3D::m_utf8_bom_count },
+    };
+
+    return checks;
+}
+
+std::vector<std::string> AC3D::checkNames()
+{
+    std::vector<std::string> names;
+
+    for (const auto &check : checkTable())
+        names.emplace_back(check.name);
+
+    return names;
+}
+
+const char *AC3D::checkName(const size_t *count) const
+{
+    if (count != nullptr)
+    {
+        for (const auto &check : checkTable())
+        {
+            if (&(this->*check.count) == count)
+                return check.name;
+        }
+    }
+
+    return "";
+}
+
+bool AC3D::maxDiagnostics(const std::string &name, size_t max)
+{
+    for (const auto &check : checkTable())
+    {
+        if (name == check.name)
+        {
+            m_max_check_diagnostics.emplace_back(check.count, max);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Counts the diagnostic as shown unless it's quiet or a limit has been
+// reached. Called before the count for the check is incremented.
+bool AC3D::showDiagnostic(const size_t *count)
+{
+    m_suppressed = m_quiet || (count != nullptr ? limitReached(*count) : m_diagnostics_shown >= m_max_diagnostics);
+
+    if (!m_suppressed)
+        m_diagnostics_shown++;
+
+    return !m_suppressed;
+}
+
+// True when no more diagnostics from the check with this count will be
+// shown. They are still counted.
+bool AC3D::limitReached(const size_t &count) const
 {
-    if (!m_quiet)
+    if (m_diagnostics_shown >= m_max_diagnostics)
+        return true;
+
+    for (const auto &max : m_max_check_diagnostics)
     {
-        std::cerr << in.str() << std::endl;
+        if (&(this->*max.first) == &count)
+            return count >= max.second;
+    }
+
+    return false;
+}
+
+// The number of warnings and errors is shown after text output and each
+// check's count with --summary, so they must be exact.
+bool AC3D::totalsShown() const
+{
+    return m_summary || m_diagnostic_format == DiagnosticFormat::text;
+}
 
+void AC3D::showLine(std::istringstream &in) const
+{
+    if (!m_quiet && !m_suppressed)
+    {
         std::streambuf *buf = in.rdbuf();
         const std::streampos pos = buf->pubseekoff(0, std::ios_base::cur, std::ios_base::in);
         buf->pubseekpos(pos, std::ios_base::in);
 
+        if (m_diagnostic_format != DiagnosticFormat::text)
+        {
+            showColumn(static_cast<size_t>(pos) + 1, in.str());
+            return;
+        }
+
+        *m_err << in.str() << std::endl;
+
         for (std::streamoff i = 0; i < static_cast<std::streamoff>(pos); ++i)
-            std::cerr << ' ';
-        std::cerr << '^' << std::endl;
+            *m_err << ' ';
+        *m_err << '^' << std::endl;
     }
 }
 
 void AC3D::showLine(const std::istringstream &in, const std::streampos &pos) const
 {
-    if (!m_quiet)
+    if (!m_quiet && !m_suppressed)
     {
-        std::cerr << in.str() << std::endl;
+        if (m_diagnostic_format != DiagnosticFormat::text)
+        {
+            showColumn(static_cast<size_t>(pos) + 1, in.str());
+            return;
+        }
+
+        *m_err << in.str() << std::endl;
 
         for (std::streamoff i = 0; i < static_cast<std::streamoff>(pos); ++i)
-            std::cerr << ' ';
-        std::cerr << '^' << std::endl;
+            *m_err << ' ';
+        *m_err << '^' << std::endl;
     }
 }
 
 void AC3D::showLine(std::istream &in, const std::streampos &pos, int offset) const
 {
-    if (!m_quiet)
+    if (!m_quiet && !m_suppressed)
     {
         const std::streampos current = in.tellg();
         std::string line;
@@ -242,12 +435,18 @@ void AC3D::showLine(std::istream &in, const std::streampos &pos, int offset) con
         // remove CR
         if (!line.empty() && line.back() == '\r')
             line.pop_back();
-        std::cerr << line << std::endl;
         if (offset < 0)
             offset = static_cast<int>(line.size());
+        if (m_diagnostic_format != DiagnosticFormat::text)
+        {
+            showColumn(static_cast<size_t>(offset) + 1, line);
+            in.seekg(current);
+            return;
+        }
+        *m_err << line << std::endl;
         for (int i = 0; i < offset; ++i)
-            std::cerr << ' ';
-        std::cerr << '^' << std::endl;
+            *m_err << ' ';
+        *m_err << '^' << std::endl;
 
         in.seekg(current);
     }
@@ -259,15 +458,41 @@ class newline
 public:
     explicit newline(bool crlf) : m_crlf(crlf) {}
 
-    friend std::ostream &operator << (std::ostream &os, const newline &nl)
+    friend Writer &operator << (Writer &out, const newline &nl)
     {
         if (nl.m_crlf)
-            os << '\r';
-        os << '\n';
-        return os;
+            out << '\r';
+        out << '\n';
+        return out;
     }
 };
 
+Writer & operator << (Writer &out, const AC3D::quoted_string &s)
+{
+    if (s == "empty_texture_no_mapping")
+        out << static_cast<const std::string &>(s);
+    else
+        out << '\"' << static_cast<const std::string &>(s) << '\"';
+    return out;
+}
+
+namespace
+{
+
+template <size_t s>
+Writer & operator << (Writer &out, const std::array<double,s> &a)
+{
+    for (size_t i = 0; i < s; ++i)
+    {
+        if (i != 0)
+            out << ' ';
+        out << a[i];
+    }
+    return out;
+}
+
+} // namespace
+
 bool AC3D::getLine(std::istream &in)
 {
     m_line_pos = in.tellg();
@@ -293,6 +518,7 @@ bool AC3D::getLine(std::istream &in)
 
         if (m_line.empty() || isWhitespace(m_line))
         {
+            m_rewritten_lines++;
             if (m_blank_line)
                 warningWithCount(m_blank_line_count) << "blank line" << std::endl;
             empty = true;
@@ -309,69 +535,198 @@ bool AC3D::ungetLine(std::istream &in)
     return true;
 }
 
-std::ostream &AC3D::warningWithCount(size_t &count, size_t line_number)
+AC3D::DiagnosticStream AC3D::warningWithCount(size_t &count, size_t line_number)
 {
+    const bool show = showDiagnostic(&count);
     count++;
     m_warnings++;
-    if (!m_quiet)
+    if (show)
     {
+        if (m_diagnostic_format != DiagnosticFormat::text)
+            return DiagnosticStream(&beginDiagnostic("warning", &count, line_number));
         if (line_number > 0)
-            std::cerr << m_file << ":" << line_number << " warning: ";
+            *m_err << m_file << ":" << line_number << " warning: ";
         else
-            std::cerr << m_file << ":" << m_line_number << " warning: ";
-        return std::cerr;
+            *m_err << m_file << ":" << m_line_number << " warning: ";
+        return DiagnosticStream(m_err);
     }
-    return m_null_stream;
+    return DiagnosticStream();
 }
 
-std::ostream &AC3D::error(size_t line_number)
+AC3D::DiagnosticStream AC3D::error(size_t line_number)
 {
     m_errors++;
-    if (!m_quiet)
+    if (showDiagnostic(nullptr))
     {
+        if (m_diagnostic_format != DiagnosticFormat::text)
+            return DiagnosticStream(&beginDiagnostic("error", nullptr, line_number));
+        if (m_diagnostic_buf != nullptr)
+            m_diagnostic_buf->error();
         if (line_number > 0)
-            std::cerr << m_file << ":" << line_number << " error: ";
+            *m_err << m_file << ":" << line_number << " error: ";
         else
-            std::cerr << m_file << ":" << m_line_number << " error: ";
-        return std::cerr;
+            *m_err << m_file << ":" << m_line_number << " error: ";
+        return DiagnosticStream(m_err);
     }
-    return m_null_stream;
+    return DiagnosticStream();
 }
 
-std::ostream &AC3D::errorWithCount(size_t &count, size_t line_number)
+AC3D::DiagnosticStream AC3D::errorWithCount(size_t &count, size_t line_number)
 {
+    const bool show = showDiagnostic(&count);
     count++;
     m_errors++;
-    if (!m_quiet)
+    if (show)
     {
+        if (m_diagnostic_format != DiagnosticFormat::text)
+            return DiagnosticStream(&beginDiagnostic("error", &count, line_number));
+        if (m_diagnostic_buf != nullptr)
+            m_diagnostic_buf->error();
         if (line_number > 0)
-            std::cerr << m_file << ":" << line_number << " error: ";
+            *m_err << m_file << ":" << line_number << " error: ";
         else
-            std::cerr << m_file << ":" << m_line_number << " error: ";
-        return std::cerr;
+            *m_err << m_file << ":" << m_line_number << " error: ";
+        return DiagnosticStream(m_err);
+    }
+    return DiagnosticStream();
+}
+
+AC3D::DiagnosticStream AC3D::note(size_t line_number)
+{
+    if (!m_quiet && !m_suppressed)
+    {
+        if (m_diagnostic_format != DiagnosticFormat::text)
+        {
+            // a note without a diagnostic to attach it to stands alone
+            if (!m_has_diagnostic)
+                return DiagnosticStream(&beginDiagnostic("note", nullptr, line_number));
+
+            takeDiagnosticMessage();
+            m_diagnostic.notes.emplace_back();
+            m_diagnostic.notes.back().line = line_number;
+            return DiagnosticStream(&m_diagnostic_message);
+        }
+        *m_err << m_file << ":" << line_number << " note: ";
+        return DiagnosticStream(m_err);
     }
-    return m_null_stream;
+    return DiagnosticStream();
 }
 
-std::ostream &AC3D::note(size_t line_number)
+// Messages that aren't warnings or errors from a check, like a file that
+// can't be read.
+std::ostream &AC3D::message()
 {
-    if (!m_quiet)
+    if (m_diagnostic_format != DiagnosticFormat::text)
     {
-        std::cerr << m_file << ":" << line_number << " note: ";
-        return std::cerr;
+        std::ostream &out = beginDiagnostic("error", nullptr, 0);
+        m_diagnostic.location.line = 0;
+        return out;
     }
-    return m_null_stream;
+    return *m_err;
+}
+
+void AC3D::showMessages(const std::string &text)
+{
+    if (m_diagnostic_format == DiagnosticFormat::text)
+    {
+        *m_err << text;
+        return;
+    }
+
+    std::istringstream in(text);
+    std::string line;
+
+    while (std::getline(in, line))
+        message() << line << std::endl;
+}
+
+std::ostream &AC3D::beginDiagnostic(const char *severity, const size_t *count, size_t line_number)
+{
+    finishDiagnostics();
+
+    m_has_diagnostic = true;
+    m_diagnostic.file = m_file;
+    m_diagnostic.severity = severity;
+    m_diagnostic.check = checkName(count);
+    m_diagnostic.location.line = line_number > 0 ? line_number : m_line_number;
+
+    return m_diagnostic_message;
+}
+
+// moves what was written for the diagnostic or its last note into it
+void AC3D::takeDiagnosticMessage() const
+{
+    std::string text = m_diagnostic_message.str();
+
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+        text.pop_back();
+
+    if (!text.empty())
+    {
+        std::string &message = m_diagnostic.notes.empty() ? m_diagnostic.location.message : m_diagnostic.notes.back().message;
+
+        if (!message.empty())
+            message += '\n';
+        message += text;
+    }
+
+    m_diagnostic_message.str(std::string());
+}
+
+// where showLine() would have put the caret
+void AC3D::showColumn(size_t column, std::string_view source) const
+{
+    takeDiagnosticMessage();
+
+    Diagnostic::Location &location = m_diagnostic.notes.empty() ? m_diagnostic.location : m_diagnostic.notes.back();
+
+    location.column = column;
+    if (m_source_excerpts)
+        location.source = source;
+}
+
+void AC3D::finishDiagnostics()
+{
+    if (!m_has_diagnostic)
+        return;
+
+    takeDiagnosticMessage();
+
+    Writer out;
+
+    if (m_diagnostic_format == DiagnosticFormat::sarif)
+        writeSarifResult(out, m_diagnostic);
+    else
+        writeJsonLines(out, m_diagnostic);
+
+    if (m_diagnostic_buf != nullptr && m_diagnostic.severity == "error")
+        m_diagnostic_buf->error();
+
+    *m_err << out.buffer() << std::flush;
+
+    m_diagnostic = Diagnostic();
+    m_has_diagnostic = false;
 }
 
 void AC3D::checkTrailing(std::istringstream &iss)
 {
-    if (!m_trailing_text)
+    // still looked for when the warning is off for --copyUnchanged
+    if (!m_trailing_text && !m_copy_unchanged)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkTrailing");
+
     const std::streampos pos = iss.tellg();
     if (hasTrailing(iss))
     {
-        warningWithCount(m_trailing_text_count) << "trailing text: \"" << getTrailing(iss) << "\"" << std::endl;
+        m_rewritten_lines++;
+
+        if (!m_trailing_text)
+            return;
+
+        // the text is only copied when it is shown
+        if (const DiagnosticStream diagnostic = warningWithCount(m_trailing_text_count))
+            diagnostic << "trailing text: \"" << getTrailing(iss) << "\"" << std::endl;
         showLine(iss, pos);
     }
 }
@@ -403,13 +758,16 @@ bool AC3D::readRef(std::istringstream &in, AC3D::Ref &ref)
         ref.coordinates.push_back(uv);
         if (hasTrailing(in))
         {
+            // the text after a coordinate is only needed when the next one
+            // can't be read or a warning is shown
             std::streampos pos = in.tellg();
-            std::string trailing = getTrailing(in);
             if (m_is_ac)
             {
+                m_rewritten_lines++;
                 if (m_trailing_text)
                 {
-                    warningWithCount(m_trailing_text_count) << "trailing text: \"" << trailing << "\"" << std::endl;
+                    if (const DiagnosticStream diagnostic = warningWithCount(m_trailing_text_count))
+                        diagnostic << "trailing text: \"" << getTrailing(in) << "\"" << std::endl;
                     showLine(in, pos);
                 }
             }
@@ -422,7 +780,6 @@ bool AC3D::readRef(std::istringstream &in, AC3D::Ref &ref)
                     if (hasTrailing(in))
                     {
                         pos = in.tellg();
-                        trailing = getTrailing(in);
                         in >> uv;
                         if (in)
                         {
@@ -430,26 +787,28 @@ bool AC3D::readRef(std::istringstream &in, AC3D::Ref &ref)
                             if (hasTrailing(in))
                             {
                                 pos = in.tellg();
-                                trailing = getTrailing(in);
                                 in >> uv;
                                 if (in)
                                 {
                                     ref.coordinates.push_back(uv);
                                     if (hasTrailing(in))
                                     {
+                                        m_rewritten_lines++;
                                         if (m_trailing_text)
                                         {
                                             pos = in.tellg();
-                                            trailing = getTrailing(in);
-                                            warningWithCount(m_trailing_text_count) << "trailing text: \"" << trailing << "\"" << std::endl;
+                                            if (const DiagnosticStream diagnostic = warningWithCount(m_trailing_text_count))
+                                                diagnostic << "trailing text: \"" << getTrailing(in) << "\"" << std::endl;
                                             showLine(in, pos);
                                         }
                                     }
                                 }
                                 else
                                 {
+                                    const std::string trailing = getTrailing(in, pos);
                                     if (isWhitespace(trailing))
                                     {
+                                        m_rewritten_lines++;
                                         if (m_trailing_text)
                                         {
                                             warningWithCount(m_trailing_text_count) << "trailing text: \"" << trailing << "\"" << std::endl;
@@ -470,8 +829,10 @@ bool AC3D::readRef(std::istringstream &in, AC3D::Ref &ref)
                         }
                         else
                         {
+                            const std::string trailing = getTrailing(in, pos);
                             if (isWhitespace(trailing))
                             {
+                                m_rewritten_lines++;
                                 if (m_trailing_text)
                                 {
                                     warningWithCount(m_trailing_text_count) << "trailing text: \"" << trailing << "\"" << std::endl;
@@ -492,8 +853,10 @@ bool AC3D::readRef(std::istringstream &in, AC3D::Ref &ref)
                 }
                 else
                 {
+                    const std::string trailing = getTrailing(in, pos);
                     if (isWhitespace(trailing))
                     {
+                        m_rewritten_lines++;
                         if (m_trailing_text)
                         {
                             warningWithCount(m_trailing_text_count) << "trailing text: \"" << trailing << "\"" << std::endl;
@@ -517,8 +880,8 @@ bool AC3D::readRef(std::istringstream &in, AC3D::Ref &ref)
     {
         if (m_invalid_texture_coordinate)
         {
-            std::string trailing = getTrailing(in);
-            errorWithCount(m_invalid_texture_coordinate_count) << "invalid texture coordinate: \"" << trailing << "\"" << std::endl;
+            if (const DiagnosticStream diagnostic = errorWithCount(m_invalid_texture_coordinate_count))
+                diagnostic << "invalid texture coordinate: \"" << getTrailing(in) << "\"" << std::endl;
             showLine(in);
         }
         ref.invalid_coordinates = true;
@@ -527,7 +890,7 @@ bool AC3D::readRef(std::istringstream &in, AC3D::Ref &ref)
     return true;
 }
 
-void AC3D::writeRef(std::ostream &out, const AC3D::Ref &ref) const
+void AC3D::writeRef(Writer &out, const AC3D::Ref &ref) const
 {
     out << ref.index;
     for (const auto &coord : ref.coordinates)
@@ -566,9 +929,11 @@ bool AC3D::readSurface(std::istream &in, Surface &surface, Object &object, bool
             }
 
             checkTrailing(iss);
+            prefetchTransparentTexture(object, surface);
         }
         else
         {
+            m_rewritten_lines++;
             if (m_invalid_surface_type)
             {
                 std::string junk;
@@ -661,12 +1026,20 @@ bool AC3D::readSurface(std::istream &in, Surface &surface, Object &object, bool
 
         if (iss)
             checkTrailing(iss);
-        else if (m_invalid_refs_count)
+        else
         {
-            errorWithCount(m_invalid_refs_count_count) << "invalid refs count" << std::endl;
-            showLine(iss);
+            m_rewritten_lines++;
+            if (m_invalid_refs_count)
+            {
+                errorWithCount(m_invalid_refs_count_count) << "invalid refs count" << std::endl;
+                showLine(iss);
+            }
         }
 
+        // reserve the declared count, capped so a bad count can't exhaust memory
+        if (surface.refs.declared_size > 0)
+            surface.refs.reserve(static_cast<size_t>(std::min(surface.refs.declared_size, 1024)));
+
         for (int j = 0; j < surface.refs.declared_size; ++j)
         {
             // declared_size comes straight from the file and is otherwise
@@ -721,11 +1094,13 @@ bool AC3D::readSurface(std::istream &in, Surface &surface, Object &object, bool
                 }
             }
 
-            surface.refs.push_back(ref);
+            surface.refs.push_back(std::move(ref));
         }
 
         surface.setTriangleStrip(object);
 
+        const Profiler::Scope scope(m_profiler, "checkSurface");
+
         checkDuplicateSurfaceVertices(in, object, surface);
         checkCollinearSurfaceVertices(in, object, surface);
         checkSurfaceCoplanar(in, object, surface);
@@ -741,6 +1116,7 @@ bool AC3D::readSurface(std::istream &in, Surface &surface, Object &object, bool
     }
     else
     {
+        m_rewritten_lines++;
         if (m_invalid_token)
         {
             errorWithCount(m_invalid_token_count) << "invalid token: " << token << std::endl;
@@ -752,9 +1128,9 @@ bool AC3D::readSurface(std::istream &in, Surface &surface, Object &object, bool
     return true;
 }
 
-void AC3D::writeSurface(std::ostream &out, const Surface &surface) const
+void AC3D::writeSurface(Writer &out, const Surface &surface) const
 {
-    out << "SURF 0x" << std::hex << surface.flags << std::dec << newline(m_crlf);
+    (out << "SURF 0x").hex(surface.flags) << newline(m_crlf);
     if (!surface.mats.empty())
         out << "mat " << surface.mats[0].mat << newline(m_crlf);
     out << "refs " << surface.refs.size() << newline(m_crlf);
@@ -762,7 +1138,7 @@ void AC3D::writeSurface(std::ostream &out, const Surface &surface) const
         writeRef(out, ref);
 }
 
-void  AC3D::writeSurfaces(std::ostream &out, const Object &object) const
+void  AC3D::writeSurfaces(Writer &out, const Object &object) const
 {
     if (!object.surfaces.empty())
     {
@@ -772,7 +1148,7 @@ void  AC3D::writeSurfaces(std::ostream &out, const Object &object) const
     }
 }
 
-void AC3D::writeVertices(std::ostream &out, const Object &object) const
+void AC3D::writeVertices(Writer &out, const Object &object) const
 {
     if (!object.vertices.empty())
     {
@@ -1171,7 +1547,8 @@ bool AC3D::readHeader(std::istream &in)
     {
         if (m_trailing_text)
         {
-            warningWithCount(m_trailing_text_count, 1) << "trailing text: \"" << m_line.substr(5) << "\"" << std::endl;
+            if (const DiagnosticStream diagnostic = warningWithCount(m_trailing_text_count, 1))
+                diagnostic << "trailing text: \"" << m_line.substr(5) << "\"" << std::endl;
             showLine(iss, 5);
         }
     }
@@ -1179,7 +1556,7 @@ bool AC3D::readHeader(std::istream &in)
     return true;
 }
 
-void AC3D::writeHeader(std::ostream &out, const Header &header) const
+void AC3D::writeHeader(Writer &out, const Header &header) const
 {
     out << header.version << newline(m_crlf);
 }
@@ -1223,7 +1600,8 @@ bool AC3D::readData(std::istringstream &iss, std::istream &in, std::string &data
                 {
                     if (m_trailing_text)
                     {
-                        warningWithCount(m_trailing_text_count) << "trailing text: \"" << data.substr(size) << "\"" << std::endl;
+                        if (const DiagnosticStream diagnostic = warningWithCount(m_trailing_text_count))
+                            diagnostic << "trailing text: \"" << data.substr(size) << "\"" << std::endl;
                         if (m_line.back() == '\r') // remove DOS CR
                             m_line.pop_back();
                         const std::istringstream iss1(m_line);
@@ -1246,15 +1624,20 @@ bool AC3D::readData(std::istringstream &iss, std::istream &in, std::string &data
     return true;
 }
 
-void AC3D::writeData(std::ostream &out, const std::string &data) const
+void AC3D::writeData(Writer &out, const std::string &data) const
 {
     out << "data " << data.size() << newline(m_crlf);
-    for (const char c : data)
+    if (m_crlf)
     {
-        if (c == '\n' && m_crlf)
-            out << '\r';
-        out << c;
+        for (const char c : data)
+        {
+            if (c == '\n')
+                out << '\r';
+            out << c;
+        }
     }
+    else
+        out << data;
     out << newline(m_crlf);
 }
 
@@ -1744,7 +2127,7 @@ bool AC3D::readMaterial(std::istringstream &first, std::istream &in, Material &m
     return false;
 }
 
-void AC3D::writeMaterial(std::ostream &out, const Material &material) const
+void AC3D::writeMaterial(Writer &out, const Material &material) const
 {
     if (!material.version12)
     {
@@ -1773,6 +2156,10 @@ void AC3D::writeMaterial(std::ostream &out, const Material &material) const
 
 bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
 {
+    Profiler::Scope scope(m_profiler, "readObject", Profiler::Trace::yes);
+
+    const size_t rewritten_lines = m_rewritten_lines;
+
     object.line_number = m_line_number;
     object.line_pos = m_line_pos;
 
@@ -1807,6 +2194,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
             if (icasecmp(object.type.type, world_token) || icasecmp(object.type.type, group_token) ||
                 icasecmp(object.type.type, poly_token) || icasecmp(object.type.type, light_token))
             {
+                m_rewritten_lines++;
                 if (m_invalid_object_type)
                 {
                     warningWithCount(m_invalid_object_type_count) << "invalid object type: " << object.type.type << " should be lowercase" << std::endl;
@@ -1899,9 +2287,11 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                 {
                     if (m_is_ac)
                     {
+                        m_rewritten_lines++;
                         if (m_trailing_text)
                         {
-                            warningWithCount(m_trailing_text_count) << "trailing text: \"" << getTrailing(iss1) << "\"" << std::endl;
+                            if (const DiagnosticStream diagnostic = warningWithCount(m_trailing_text_count))
+                                diagnostic << "trailing text: \"" << getTrailing(iss1) << "\"" << std::endl;
                             showLine(iss1);
                         }
                     }
@@ -1912,18 +2302,22 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                         {
                             if (hasTrailing(iss1))
                             {
+                                m_rewritten_lines++;
                                 if (m_trailing_text)
                                 {
-                                    warningWithCount(m_trailing_text_count) << "trailing text: \"" << getTrailing(iss1) << "\"" << std::endl;
+                                    if (const DiagnosticStream diagnostic = warningWithCount(m_trailing_text_count))
+                                        diagnostic << "trailing text: \"" << getTrailing(iss1) << "\"" << std::endl;
                                     showLine(iss1);
                                 }
                             }
                         }
                         else
                         {
+                            m_rewritten_lines++;
                             if (m_trailing_text)
                             {
-                                warningWithCount(m_trailing_text_count) << "trailing text: \"" << getTrailing(iss1) << "\"" << std::endl;
+                                if (const DiagnosticStream diagnostic = warningWithCount(m_trailing_text_count))
+                                    diagnostic << "trailing text: \"" << getTrailing(iss1) << "\"" << std::endl;
                                 showLine(iss1);
                             }
                         }
@@ -1940,105 +2334,44 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
 
                 if (texture.name != "empty_texture_no_mapping")
                 {
-                    const std::filesystem::path file_path(m_file);
-                    std::string texture_name(texture.name);
-                    std::filesystem::path texture_path(texture_name);
-                    const bool absolute = texture_path.is_absolute() ||
-                        (texture_name.size() >= 2 &&
-                         std::isalpha(static_cast<unsigned char>(texture_name[0])) != 0 &&
-                         texture_name[1] == ':');
-
-                    texture.path = texture.name;
-
-                    // use parent path of file when available
-                    // and texture path is not absolute
-                    if (!file_path.parent_path().empty() && !absolute)
-                    {
-                        texture_path = file_path.parent_path().append(texture_name);
+                    const TextureLookup &lookup = lookupTexture(texture.name);
 
-                        if (std::filesystem::exists(texture_path))
-                            texture.path = texture_path.generic_string();
-                    }
+                    texture.path = lookup.path;
 
-                    if (!std::filesystem::exists(texture_path))
+                    if (lookup.missing && m_missing_texture)
                     {
-                        bool found = false;
+                        warningWithCount(m_missing_texture_count) << "missing texture: " << std::quoted(lookup.texture_path) << std::endl;
+                        showLine(iss1, 0);
+                    }
 
-                        if (!absolute) // don't search if absolute path
+                    for (const auto &[other, match] : lookup.others)
+                    {
+                        if (match == TextureMatch::duplicate)
                         {
-                            // look in alternate paths if available
-                            for (const auto &path : m_texture_paths)
+                            if (m_duplicate_texture)
                             {
-                                const std::filesystem::path new_path = std::filesystem::path(path).append(texture_name);
-                                if (std::filesystem::exists(new_path))
-                                {
-                                    found = true;
-                                    texture.path = new_path.generic_string();
-                                    break;
-                                }
+                                warningWithCount(m_duplicate_texture_count)
+                                    << "duplicate texture: " << std::quoted(lookup.texture_path)
+                                    << " and " << std::quoted(other) << std::endl;
+                                showLine(iss1, 0);
                             }
                         }
-
-                        if (!found && m_missing_texture)
-                        {
-                            warningWithCount(m_missing_texture_count) << "missing texture: " << std::quoted(texture_path.generic_string()) << std::endl;
-                            showLine(iss1, 0);
-                        }
-                    }
-                    else if (!absolute && !m_texture_paths.empty()) // look for duplicate textures
-                    {
-                        const std::size_t size = std::filesystem::file_size(texture_path);
-
-                        for (const auto &path : m_texture_paths)
+                        else if (match == TextureMatch::ambiguous)
                         {
-                            const std::filesystem::path other = std::filesystem::path(path).append(texture_name);
-                            if (std::filesystem::exists(other))
+                            if (m_ambiguous_texture)
                             {
-                                if (texture.path.empty())
-                                    texture.path = other.generic_string();
-
-                                if (size == std::filesystem::file_size(other))
-                                {
-                                    std::ifstream file1(texture_path, std::ifstream::binary);
-                                    std::ifstream file2(other, std::ifstream::binary);
-                                    if (file1.good() && file2.good())
-                                    {
-                                        if (std::equal(std::istreambuf_iterator<char>(file1),
-                                                       std::istreambuf_iterator<char>(),
-                                                       std::istreambuf_iterator<char>(file2)))
-                                        {
-                                            if (m_duplicate_texture)
-                                            {
-                                                warningWithCount(m_duplicate_texture_count)
-                                                    << "duplicate texture: " << std::quoted(texture_path.generic_string())
-                                                    << " and " << std::quoted(other.generic_string()) << std::endl;
-                                                showLine(iss1, 0);
-                                            }
-                                        }
-                                        else
-                                        {
-                                            if (m_ambiguous_texture)
-                                            {
-                                                warningWithCount(m_ambiguous_texture_count)
-                                                    << "ambiguous texture: " << std::quoted(texture_path.generic_string())
-                                                    << " and " << std::quoted(other.generic_string()) << std::endl;
-                                                showLine(iss1, 0);
-                                            }
-                                        }
-                                    }
-                                }
-                                else if (m_ambiguous_texture)
-                                {
-                                    warningWithCount(m_ambiguous_texture_count)
-                                        << "ambiguous texture: " << std::quoted(texture_path.generic_string())
-                                        << " and " << std::quoted(other.generic_string()) << std::endl;
-                                    showLine(iss1, 0);
-                                }
+                                warningWithCount(m_ambiguous_texture_count)
+                                    << "ambiguous texture: " << std::quoted(lookup.texture_path)
+                                    << " and " << std::quoted(other) << std::endl;
+                                showLine(iss1, 0);
                             }
                         }
                     }
                 }
 
+                if (object.textures.empty() && !texture.path.empty())
+                    m_texture_files.emplace(texture.path, texture);
+
                 object.textures.push_back(texture);
             }
             else
@@ -2312,6 +2645,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                 checkTrailing(iss1);
             else
             {
+                m_rewritten_lines++;
                 if (m_invalid_numvert)
                 {
                     errorWithCount(m_invalid_numvert_count) << "invalid numvert" << std::endl;
@@ -2335,12 +2669,13 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                         if (hasTrailing(iss2))
                         {
                             const std::streampos pos2 = iss2.tellg();
-                            const std::string trailing = getTrailing(iss2);
                             if (m_is_ac)
                             {
+                                m_rewritten_lines++;
                                 if (m_trailing_text)
                                 {
-                                    warningWithCount(m_trailing_text_count) << "trailing text: \"" << trailing << "\"" << std::endl;
+                                    if (const DiagnosticStream diagnostic = warningWithCount(m_trailing_text_count))
+                                        diagnostic << "trailing text: \"" << getTrailing(iss2) << "\"" << std::endl;
                                     showLine(iss2, pos2);
                                 }
                             }
@@ -2377,6 +2712,9 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                                 }
                                 else
                                 {
+                                    // what couldn't be read as a normal
+                                    const std::string trailing = getTrailing(iss2, pos2);
+                                    m_rewritten_lines++;
                                     if (isWhitespace(trailing))
                                     {
                                         if (m_trailing_text)
@@ -2414,6 +2752,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                             break;
                         }
 
+                        m_rewritten_lines++;
                         if (m_invalid_vertex)
                         {
                             // reparse line to find error position
@@ -2438,7 +2777,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                         }
                     }
 
-                    object.vertices.push_back(vertex);
+                    object.vertices.push_back(std::move(vertex));
                 }
 
                 continue;
@@ -2462,12 +2801,13 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                         if (hasTrailing(iss2))
                         {
                             const std::streampos pos2 = iss2.tellg();
-                            const std::string trailing = getTrailing(iss2);
                             if (m_is_ac)
                             {
+                                m_rewritten_lines++;
                                 if (m_trailing_text)
                                 {
-                                    warningWithCount(m_trailing_text_count) << "trailing text: \"" << trailing << "\"" << std::endl;
+                                    if (const DiagnosticStream diagnostic = warningWithCount(m_trailing_text_count))
+                                        diagnostic << "trailing text: \"" << getTrailing(iss2) << "\"" << std::endl;
                                     showLine(iss2, pos2);
                                 }
                             }
@@ -2504,6 +2844,9 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                                 }
                                 else
                                 {
+                                    // what couldn't be read as a normal
+                                    const std::string trailing = getTrailing(iss2, pos2);
+                                    m_rewritten_lines++;
                                     if (isWhitespace(trailing))
                                     {
                                         if (m_trailing_text)
@@ -2547,6 +2890,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                             break;
                         }
 
+                        m_rewritten_lines++;
                         if (m_invalid_vertex)
                         {
                             // reparse line to find error position
@@ -2571,7 +2915,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                         }
                     }
 
-                    object.vertices.push_back(vertex);
+                    object.vertices.push_back(std::move(vertex));
                 }
             }
 
@@ -2591,6 +2935,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
 
             if (!iss1 || object.numsurf.number < 0)
             {
+                m_rewritten_lines++;
                 if (m_invalid_numsurf)
                 {
                     errorWithCount(m_invalid_numsurf_count) << "invalid numsurf" << std::endl;
@@ -2601,6 +2946,12 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
 
             checkTrailing(iss1);
 
+            // a span for all the surfaces rather than one for each SURF
+            Profiler::Scope surfaces(m_profiler, "readSurfaces", Profiler::Trace::yes);
+
+            if (!object.names.empty())
+                surfaces.arg(object.names.back().name);
+
             for (int i = 0; i < object.numsurf.number; ++i)
             {
                 Surface surface;
@@ -2608,7 +2959,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                 if (!readSurface(in, surface, object, true))
                     break;
 
-                object.surfaces.push_back(surface);
+                object.surfaces.push_back(std::move(surface));
             }
         }
         else if (token == kids_token)
@@ -2624,7 +2975,20 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
             iss1 >> kids;
 
             if (iss1 && kids >= 0)
+            {
                 checkTrailing(iss1);
+
+                // Only objects that would be written the same way they were
+                // read can be copied. That doesn't depend on which warnings
+                // are shown so the output doesn't either.
+                if (m_source_file != 0 && m_rewritten_lines == rewritten_lines && canCopy(object))
+                {
+                    object.source.file = m_source_file;
+                    object.source.begin = object.line_pos;
+                    object.source.end = m_line_pos;
+                    object.source.fingerprint = fingerprint(object);
+                }
+            }
             else
             {
                 if (m_invalid_kids_count)
@@ -2645,7 +3009,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                     {
                         Object kid;
                         readObject(iss2, in, kid);
-                        object.kids.push_back(kid);
+                        object.kids.push_back(std::move(kid));
                     }
                     else
                     {
@@ -2679,7 +3043,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                         {
                             Object kid;
                             readObject(iss2, in, kid);
-                            object.kids.push_back(kid);
+                            object.kids.push_back(std::move(kid));
                         }
                         else
                         {
@@ -2713,7 +3077,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                                     {
                                         Object kid;
                                         readObject(iss2, in, kid);
-                                        object.kids.push_back(kid);
+                                        object.kids.push_back(std::move(kid));
                                         break;
                                     }
                                 }
@@ -2758,7 +3122,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
                     }
                 }
 
-                object.shaders.push_back(shader);
+                object.shaders.push_back(std::move(shader));
 
                 checkTrailing(iss1);
             }
@@ -2770,6 +3134,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
         }
         else if (token == MATERIAL_token)
         {
+            m_rewritten_lines++;
             if (m_material_after_object)
             {
                 warningWithCount(m_material_after_object_count) << "MATERIAL after OBJECT" << std::endl;
@@ -2777,10 +3142,11 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
             }
             Material material;
             readMaterial(iss1, material);
-            m_materials.push_back(material);
+            m_materials.push_back(std::move(material));
         }
         else if (token == MAT_token && m_header.getVersion() == 12)
         {
+            m_rewritten_lines++;
             if (m_material_after_object)
             {
                 warningWithCount(m_material_after_object_count) << "MAT after OBJECT" << std::endl;
@@ -2788,7 +3154,7 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
             }
             Material material;
             readMaterial(iss1, in, material);
-            m_materials.push_back(material);
+            m_materials.push_back(std::move(material));
         }
         else if (token == SURF_token)
         {
@@ -2803,12 +3169,16 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
             Surface surface;
 
             if (readSurface(in, surface, object, false))
-                object.surfaces.push_back(surface);
+                object.surfaces.push_back(std::move(surface));
         }
-        else if (m_invalid_token)
+        else
         {
-            errorWithCount(m_invalid_token_count) << "invalid token: " << token << std::endl;
-            showLine(iss1, 0);
+            m_rewritten_lines++;
+            if (m_invalid_token)
+            {
+                errorWithCount(m_invalid_token_count) << "invalid token: " << token << std::endl;
+                showLine(iss1, 0);
+            }
         }
     }
 
@@ -2820,6 +3190,14 @@ bool AC3D::readObject(std::istringstream &iss, std::istream &in, Object &object)
         showLine(iss, 0);
     }
 
+    if (!object.names.empty())
+        scope.arg(object.names.back().name);
+
+    Profiler::Scope checks(m_profiler, "checkObject", Profiler::Trace::yes);
+
+    if (!object.names.empty())
+        checks.arg(object.names.back().name);
+
     checkUnusedVertex(in, object);
     checkMissingSurfaces(in, object);
     checkDuplicateSurfaces(in, object);
@@ -2947,7 +3325,7 @@ void AC3D::Object::removeKids(const RemoveInfo &remove_info)
     }
 }
 
-void AC3D::Object::dump(DumpType dump_type, size_t count, size_t level) const
+void AC3D::Object::dump(std::ostream &out, DumpType dump_type, size_t count, size_t level) const
 {
     std::string indent;
 
@@ -2956,43 +3334,43 @@ void AC3D::Object::dump(DumpType dump_type, size_t count, size_t level) const
 
     if (type.type == "world")
     {
-        std::cout << indent << (count + 1) << " " << type.type;
-        std::cout << " " << kids.size() << " kid" << (kids.size() == 1 ? "" : "s") << std::endl;
+        out << indent << (count + 1) << " " << type.type;
+        out << " " << kids.size() << " kid" << (kids.size() == 1 ? "" : "s") << std::endl;
     }
     else
     {
         if (type.type == "group")
         {
-            std::cout << indent << (count + 1) << " " << type.type;
+            out << indent << (count + 1) << " " << type.type;
 
             for (const auto &name : names)
-                std::cout << " " << name.name;
+                out << " " << name.name;
 
-            std::cout << " " << kids.size() << " kid" << (kids.size() == 1 ? "" : "s") << std::endl;
+            out << " " << kids.size() << " kid" << (kids.size() == 1 ? "" : "s") << std::endl;
         }
         else if (type.type == "poly" && (dump_type == DumpType::poly || dump_type == DumpType::surf))
         {
-            std::cout << indent << (count + 1) << " " << type.type;
+            out << indent << (count + 1) << " " << type.type;
 
             for (const auto &name : names)
-                std::cout << " " << name.name;
+                out << " " << name.name;
 
             if (!textures.empty())
             {
-                std::cout << " texture";
+                out << " texture";
 
                 for (const auto &texture : textures)
-                    std::cout << " " << texture.name;
+                    out << " " << texture.name;
             }
 
-            std::cout << " " << vertices.size() << " vertices";
-            std::cout << " " << surfaces.size() << " surface" << (surfaces.size() == 1 ? "" : "s") << std::endl;
+            out << " " << vertices.size() << " vertices";
+            out << " " << surfaces.size() << " surface" << (surfaces.size() == 1 ? "" : "s") << std::endl;
 
             if (dump_type == DumpType::surf)
             {
                 for (size_t i = 0; i < surfaces.size(); i++)
                 {
-                    surfaces[i].dump(i, level + 1);
+                    surfaces[i].dump(out, i, level + 1);
                 }
             }
         }
@@ -3000,26 +3378,26 @@ void AC3D::Object::dump(DumpType dump_type, size_t count, size_t level) const
 
     for (size_t i = 0; i < kids.size(); i++)
     {
-        kids[i].dump(dump_type, i, level + 1);
+        kids[i].dump(out, dump_type, i, level + 1);
     }
 }
 
-void AC3D::Surface::dump(size_t count, size_t level) const
+void AC3D::Surface::dump(std::ostream &out, size_t count, size_t level) const
 {
     for (size_t i = 0; i < level; i++)
-        std::cout << "    ";
+        out << "    ";
 
-    std::cout << (count + 1) << " surface flags 0x" << std::hex << flags << std::dec;
+    out << (count + 1) << " surface flags 0x" << std::hex << flags << std::dec;
 
     if (!mats.empty())
     {
-        std::cout << " mat";
+        out << " mat";
 
         for (const auto &mat : mats)
-            std::cout << " " << mat.mat;
+            out << " " << mat.mat;
     }
 
-    std::cout << " " << refs.size() << " ref" << (refs.size() == 1 ? "" : "s") << std::endl;
+    out << " " << refs.size() << " ref" << (refs.size() == 1 ? "" : "s") << std::endl;
 }
 
 void AC3D::Surface::setTriangleStrip(const Object &object)
@@ -3059,8 +3437,20 @@ void AC3D::Surface::setTriangleStrip(const Object &object)
     }
 }
 
-void AC3D::writeObject(std::ostream &out, const Object &object) const
+void AC3D::writeObjectData(Writer &out, const Object &object) const
 {
+    // copy the object from the input file if nothing changed it
+    if (object.source.file != 0 && object.source.file == m_source_file && !m_source.empty() &&
+        fingerprint(object) == object.source.fingerprint)
+    {
+        const size_t begin = static_cast<size_t>(object.source.begin);
+        const size_t end = static_cast<size_t>(object.source.end);
+
+        out << std::string_view(m_source).substr(begin, end - begin);
+        out << "kids " << object.kids.size() << newline(m_crlf);
+        return;
+    }
+
     out << "OBJECT " << object.type.type << newline(m_crlf);
     if (!object.names.empty())
         out << "name " << object.names.back().name << newline(m_crlf);
@@ -3099,67 +3489,282 @@ void AC3D::writeObject(std::ostream &out, const Object &object) const
     writeSurfaces(out, object);
 
     out << "kids " << object.kids.size() << newline(m_crlf);
-    for (const auto &kid : object.kids)
-        writeObject(out, kid);
 }
 
-bool AC3D::read(const std::string &file)
+void AC3D::writeObject(Writer &out, const Object &object) const
 {
-    m_file = file;
-    m_line_number = 0;
-    m_level = 0;
-    m_errors = 0;
-    m_warnings = 0;
-    m_crlf = false;
+    Profiler::Scope scope(m_profiler, "writeObject", Profiler::Trace::yes);
 
-    m_materials.clear();
-    m_objects.clear();
+    if (!object.names.empty())
+        scope.arg(object.names.back().name);
 
-    const std::string extension = std::filesystem::path(file).extension().string();
+    writeObjectData(out, object);
+    for (const auto &kid : object.kids)
+        writeObject(out, kid);
+}
 
-    if (extension == ".ac")
-        m_is_ac = true;
-    else if (extension == ".acc")
-        m_is_ac = false;
-    else
+// Whether everything read for an object is written again: one of each token
+// that is only written once, counts that match what was found and refs that
+// could be read. The lines that were changed or skipped when they were read
+// are counted by m_rewritten_lines.
+bool AC3D::canCopy(const Object &object)
+{
+    if (object.names.size() > 1 || object.urls.size() > 1 || object.locations.size() > 1 ||
+        object.rotations.size() > 1 || object.creases.size() > 1 || object.hidden.size() > 1 ||
+        object.locked.size() > 1 || object.folded.size() > 1 || object.texreps.size() > 1 ||
+        object.texoffs.size() > 1 || object.subdivs.size() > 1)
     {
-        std::cerr << "Unknown file extension: \"" << extension << "\"" << std::endl;
         return false;
     }
 
-    std::ifstream in(m_file, std::ifstream::binary);
-
-    if (!in)
+    if (object.numvert.number != static_cast<int>(object.vertices.size()) ||
+        object.numsurf.number != static_cast<int>(object.surfaces.size()))
     {
-        std::cerr << "Failed to read: \"" << m_file << "\"" << std::endl;
         return false;
     }
 
-    if (!readHeader(in))
-        return false;
+    return std::all_of(object.surfaces.begin(), object.surfaces.end(), [](const Surface &surface)
+    {
+        return surface.mats.size() <= 1 &&
+               surface.refs.declared_size == static_cast<int>(surface.refs.size()) &&
+               std::none_of(surface.refs.begin(), surface.refs.end(), [](const Ref &ref)
+               {
+                   return ref.invalid_index || ref.invalid_coordinates;
+               });
+    });
+}
 
-    bool needMaterial = true;
+// A hash of everything about an object that is written except its kids.
+// It tells if an object is still the same as when it was read.
+std::uint64_t AC3D::fingerprint(const Object &object)
+{
+    Hash64 hash;
 
-    while (getLine(in))
+    auto add = [&hash](const auto &value)
     {
-        std::istringstream iss(m_line);
-        std::string token;
-
-        iss >> token;
+        hash.update(&value, sizeof(value));
+    };
+    auto addString = [&hash, &add](const std::string &value)
+    {
+        add(value.size());
+        hash.update(value.data(), value.size());
+    };
 
-        if (needMaterial)
+    addString(object.type.type);
+    for (const auto &name : object.names)
+        addString(name.name);
+    add(object.names.size());
+    for (const auto &url : object.urls)
+        addString(url.url);
+    add(object.urls.size());
+    for (const auto &location : object.locations)
+        add(location.location);
+    add(object.locations.size());
+    for (const auto &rotation : object.rotations)
+        add(rotation.rotation);
+    add(object.rotations.size());
+    for (const auto &crease : object.creases)
+        add(crease.crease);
+    add(object.creases.size());
+    add(object.hidden.size());
+    add(object.locked.size());
+    add(object.folded.size());
+    for (const auto &data : object.data)
+        addString(data.data);
+    add(object.data.size());
+    for (const auto &shader : object.shaders)
+        addString(shader.name);
+    add(object.shaders.size());
+    for (const auto &texture : object.textures)
+    {
+        addString(texture.name);
+        addString(texture.type);
+    }
+    add(object.textures.size());
+    for (const auto &texrep : object.texreps)
+        add(texrep.texrep);
+    add(object.texreps.size());
+    for (const auto &texoff : object.texoffs)
+        add(texoff.texoff);
+    add(object.texoffs.size());
+    for (const auto &subdiv : object.subdivs)
+        add(subdiv.subdiv);
+    add(object.subdivs.size());
+    for (const auto &vertex : object.vertices)
+    {
+        add(vertex.vertex);
+        add(vertex.has_normal);
+        if (vertex.has_normal)
+            add(vertex.normal);
+    }
+    add(object.vertices.size());
+    for (const auto &surface : object.surfaces)
+    {
+        add(surface.flags);
+        for (const auto &mat : surface.mats)
+            add(mat.mat);
+        add(surface.mats.size());
+        for (const auto &ref : surface.refs)
         {
-            if (token == MATERIAL_token)
-            {
-                Material material;
-                readMaterial(iss, material);
-                m_materials.push_back(material);
+            add(ref.index);
+            for (const auto &coordinate : ref.coordinates)
+                add(coordinate);
+            add(ref.coordinates.size());
+        }
+        add(surface.refs.size());
+    }
+    add(object.surfaces.size());
+
+    return hash.digest();
+}
+
+// Reads the input file again for copying unchanged objects. Nothing is
+// copied if the file changed size since it was read.
+bool AC3D::readSource()
+{
+    m_source.clear();
+
+    if (m_source_file == 0)
+        return false;
+
+    std::error_code ec;
+
+    if (std::filesystem::file_size(m_file, ec) != m_source_size || ec)
+        return false;
+
+    std::ifstream in(m_file, std::ifstream::binary);
+
+    if (!in)
+        return false;
+
+    m_source.resize(m_source_size);
+    in.read(m_source.data(), static_cast<std::streamsize>(m_source.size()));
+
+    if (static_cast<std::uintmax_t>(in.gcount()) != m_source_size)
+    {
+        m_source.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void AC3D::writeKids(Writer &out, const Object &object)
+{
+    ThreadPool &pool = threadPool();
+
+    if (pool.threads() == 1)
+    {
+        for (const auto &kid : object.kids)
+            writeObject(out, kid);
+        return;
+    }
+
+    // look for the level with more than one kid (e.g. a world with one group)
+    if (object.kids.size() == 1)
+    {
+        writeObjectData(out, object.kids[0]);
+        writeKids(out, object.kids[0]);
+        return;
+    }
+
+    // Each kid is formatted into its own buffer on the thread pool and the
+    // buffers are written in order. Only a batch of kids is kept in memory
+    // at a time.
+    const size_t batch = pool.threads() * 16;
+
+    for (size_t first = 0; first < object.kids.size(); first += batch)
+    {
+        const size_t count = std::min(batch, object.kids.size() - first);
+        std::vector<Writer> kids(count);
+
+        pool.parallelFor(0, count, [this, &object, &kids, first](size_t i)
+        {
+            writeObject(kids[i], object.kids[first + i]);
+        }, 1);
+
+        for (const auto &kid : kids)
+            out << kid;
+    }
+}
+
+bool AC3D::read(const std::string &file)
+{
+    Profiler::Scope scope(m_profiler, "read", Profiler::Trace::yes);
+
+    scope.arg(file);
+
+    m_file = file;
+    m_line_number = 0;
+    m_level = 0;
+    m_errors = 0;
+    m_warnings = 0;
+    m_crlf = false;
+
+    m_materials.clear();
+    m_objects.clear();
+
+    m_source_file = 0;
+    m_source.clear();
+
+    if (m_copy_unchanged)
+    {
+        // a different number for every file read so objects from merged
+        // files aren't copied from this one
+        static std::atomic<size_t> source_files = 0;
+
+        std::error_code ec;
+
+        m_source_size = std::filesystem::file_size(m_file, ec);
+        if (!ec)
+            m_source_file = ++source_files;
+    }
+
+    const std::string extension = std::filesystem::path(file).extension().string();
+
+    if (extension == ".ac")
+        m_is_ac = true;
+    else if (extension == ".acc")
+        m_is_ac = false;
+    else
+    {
+        message() << "Unknown file extension: \"" << extension << "\"" << std::endl;
+        return false;
+    }
+
+    std::ifstream in(m_file, std::ifstream::binary);
+
+    if (!in)
+    {
+        message() << "Failed to read: \"" << m_file << "\"" << std::endl;
+        return false;
+    }
+
+    if (!readHeader(in))
+        return false;
+
+    bool needMaterial = true;
+
+    while (getLine(in))
+    {
+        std::istringstream iss(m_line);
+        std::string token;
+
+        iss >> token;
+
+        if (needMaterial)
+        {
+            if (token == MATERIAL_token)
+            {
+                Material material;
+                readMaterial(iss, material);
+                m_materials.push_back(std::move(material));
             }
             else if (token == MAT_token && m_header.getVersion() == 12)
             {
                 Material material;
                 readMaterial(iss, in, material);
-                m_materials.push_back(material);
+                m_materials.push_back(std::move(material));
             }
             else if (token == OBJECT_token)
             {
@@ -3171,7 +3776,7 @@ bool AC3D::read(const std::string &file)
                 Object object;
                 readObject(iss, in, object);
                 needMaterial = false;
-                m_objects.push_back(object);
+                m_objects.push_back(std::move(object));
             }
             else if (m_invalid_token)
             {
@@ -3188,7 +3793,7 @@ bool AC3D::read(const std::string &file)
             }
             Object object;
             readObject(iss, in, object);
-            m_objects.push_back(object);
+            m_objects.push_back(std::move(object));
         }
         else if (token == MATERIAL_token)
         {
@@ -3199,7 +3804,7 @@ bool AC3D::read(const std::string &file)
             }
             Material material;
             readMaterial(iss, material);
-            m_materials.push_back(material);
+            m_materials.push_back(std::move(material));
         }
         else if (token == MAT_token && m_header.getVersion() == 12)
         {
@@ -3210,7 +3815,7 @@ bool AC3D::read(const std::string &file)
             }
             Material material;
             readMaterial(iss, in, material);
-            m_materials.push_back(material);
+            m_materials.push_back(std::move(material));
         }
         else if (m_invalid_token)
         {
@@ -3235,6 +3840,8 @@ void AC3D::checkDuplicateMaterials(std::istream &in)
     if (!m_duplicate_materials)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkDuplicateMaterials");
+
     if (m_materials.size() > 1)
     {
         std::vector<bool> duplicates(m_materials.size(), false);
@@ -3288,6 +3895,8 @@ void AC3D::checkUnusedMaterial(std::istream &in)
     if (!m_unused_material)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkUnusedMaterial");
+
     if (!m_materials.empty())
     {
         for (const auto &material : m_materials)
@@ -3306,6 +3915,8 @@ void AC3D::checkMissingMat(std::istream &in)
     if (!m_missing_mat)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkMissingMat");
+
     std::vector<Object *> polys;
 
     for (auto &object : m_objects)
@@ -3403,7 +4014,19 @@ void AC3D::addPoly(std::vector<Poly> &polys, Object &object, const Matrix &matri
             }
         }
 
-        polys.emplace_back(&object, newMatrix);
+        Poly &poly = polys.emplace_back(&object, newMatrix);
+
+        for (auto &surface : object.surfaces)
+        {
+            for (const auto &triangle : surface.transformedTriangles)
+            {
+                poly.triangles.push_back({ &surface, &triangle, floatPlane(triangle) });
+                addBoundingBox(poly.boxes, triangle);
+
+                if (!surface.isDoubleSided())
+                    poly.single_sided++;
+            }
+        }
     }
     else if (object.type.type == "group" || object.type.type == "world")
     {
@@ -3415,52 +4038,100 @@ void AC3D::addPoly(std::vector<Poly> &polys, Object &object, const Matrix &matri
     }
 }
 
-void AC3D::checkOverlapping2SidedSurface(std::istream &in, const Poly &object1, const Poly &object2)
+// the triangle pairs of two objects where at least one is 2 sided
+size_t AC3D::doubleSidedPairs(const Poly &object1, const Poly &object2)
+{
+    return object1.triangles.size() * object2.triangles.size() - object1.single_sided * object2.single_sided;
+}
+
+// All the triangles of object1 are tested against the boxes of all the
+// triangles of object2 at once rather than one surface pair at a time
+// because most surfaces only have a few triangles.
+void AC3D::findOverlapping2SidedSurface(const Poly &object1, const Poly &object2, std::vector<Overlap> &overlaps, Stats::Counts *counts)
 {
-    for (const auto &surface1 : object1.object->surfaces)
+    const size_t pairs = doubleSidedPairs(object1, object2);
+
+    if (pairs == 0)
+        return;
+
+    Stats::add(counts, Stats::overlap_triangle_pairs, pairs);
+
+    if (!object2.boxes.boundsOverlap(object1.boxes))
+    {
+        Stats::add(counts, Stats::overlap_bounding_box_rejects, pairs);
+        return;
+    }
+
+    const size_t first = overlaps.size();
+    size_t tested = 0;
+
+    // the triangles of object2 whose boxes overlap a triangle of object1
+    std::vector<size_t> candidates;
+
+    for (size_t i = 0; i < object1.triangles.size(); ++i)
     {
-        for (const auto &surface2 : object2.object->surfaces)
+        const Poly::PolyTriangle &triangle1 = object1.triangles[i];
+
+        candidates.clear();
+        object2.boxes.overlapping(object1.boxes, i, candidates);
+
+        for (const size_t j : candidates)
         {
-            if (surface1.isDoubleSided() || surface2.isDoubleSided())
-            {
-                if (!surface1.transformedTriangles.empty() &&
-                    !surface2.transformedTriangles.empty())
-                {
-                    for (const auto &triangle1 : surface1.transformedTriangles)
-                    {
-                        for (const auto &triangle2 : surface2.transformedTriangles)
-                        {
-                            if (trianglesOverlap(triangle1, triangle2))
-                            {
-                                warningWithCount(m_overlapping_2_sided_surface_count, surface2.line_number) <<
-                                    "overlapping 2 sided surface (object: " <<
-                                    object2.object->getName() << " texture: " << object2.object->getTexture() <<
-                                    " sides: " << (surface2.isDoubleSided() ? "2)" : "1)") << std::endl;
-                                showLine(in, surface2.line_pos);
-                                note(triangle2.refs[0].line_number) << "ref" << std::endl;
-                                showLine(in, triangle2.refs[0].line_pos);
-                                note(triangle2.refs[1].line_number) << "ref" << std::endl;
-                                showLine(in, triangle2.refs[1].line_pos);
-                                note(triangle2.refs[2].line_number) << "ref" << std::endl;
-                                showLine(in, triangle2.refs[2].line_pos);
+            const Poly::PolyTriangle &triangle2 = object2.triangles[j];
 
-                                note(surface1.line_number) << "first instance (object: " <<
-                                    object1.object->getName() << " texture: " << object1.object->getTexture() <<
-                                    " sides: " << (surface1.isDoubleSided() ? "2)" : "1)") << std::endl;
-                                showLine(in, surface1.line_pos);
-                                note(triangle1.refs[0].line_number) << "ref" << std::endl;
-                                showLine(in, triangle1.refs[0].line_pos);
-                                note(triangle1.refs[1].line_number) << "ref" << std::endl;
-                                showLine(in, triangle1.refs[1].line_pos);
-                                note(triangle1.refs[2].line_number) << "ref" << std::endl;
-                                showLine(in, triangle1.refs[2].line_pos);
-                            }
-                        }
-                    }
-                }
-            }
+            if (!triangle1.surface->isDoubleSided() && !triangle2.surface->isDoubleSided())
+                continue;
+
+            tested++;
+
+            if (trianglesOverlap(*triangle1.triangle, *triangle2.triangle, counts, &triangle1.plane, &triangle2.plane))
+                overlaps.push_back({ &object1, &object2, triangle1.surface, triangle2.surface, triangle1.triangle, triangle2.triangle });
         }
     }
+
+    Stats::add(counts, Stats::overlap_bounding_box_rejects, pairs - tested);
+
+    // report them in the order of the surface pairs like they used to be
+    std::stable_sort(overlaps.begin() + static_cast<std::ptrdiff_t>(first), overlaps.end(), [](const Overlap &overlap1, const Overlap &overlap2)
+    {
+        if (overlap1.surface1 != overlap2.surface1)
+            return std::less<const Surface *>()(overlap1.surface1, overlap2.surface1);
+
+        return std::less<const Surface *>()(overlap1.surface2, overlap2.surface2);
+    });
+}
+
+void AC3D::checkOverlapping2SidedSurface(std::istream &in, const Overlap &overlap)
+{
+    const Object &object1 = *overlap.object1->object;
+    const Object &object2 = *overlap.object2->object;
+    const Surface &surface1 = *overlap.surface1;
+    const Surface &surface2 = *overlap.surface2;
+    const Triangle &triangle1 = *overlap.triangle1;
+    const Triangle &triangle2 = *overlap.triangle2;
+
+    warningWithCount(m_overlapping_2_sided_surface_count, surface2.line_number) <<
+        "overlapping 2 sided surface (object: " <<
+        object2.getName() << " texture: " << object2.getTexture() <<
+        " sides: " << (surface2.isDoubleSided() ? "2)" : "1)") << std::endl;
+    showLine(in, surface2.line_pos);
+    note(triangle2.refs[0].line_number) << "ref" << std::endl;
+    showLine(in, triangle2.refs[0].line_pos);
+    note(triangle2.refs[1].line_number) << "ref" << std::endl;
+    showLine(in, triangle2.refs[1].line_pos);
+    note(triangle2.refs[2].line_number) << "ref" << std::endl;
+    showLine(in, triangle2.refs[2].line_pos);
+
+    note(surface1.line_number) << "first instance (object: " <<
+        object1.getName() << " texture: " << object1.getTexture() <<
+        " sides: " << (surface1.isDoubleSided() ? "2)" : "1)") << std::endl;
+    showLine(in, surface1.line_pos);
+    note(triangle1.refs[0].line_number) << "ref" << std::endl;
+    showLine(in, triangle1.refs[0].line_pos);
+    note(triangle1.refs[1].line_number) << "ref" << std::endl;
+    showLine(in, triangle1.refs[1].line_pos);
+    note(triangle1.refs[2].line_number) << "ref" << std::endl;
+    showLine(in, triangle1.refs[2].line_pos);
 }
 
 void AC3D::checkOverlapping2SidedSurface(std::istream &in)
@@ -3468,35 +4139,56 @@ void AC3D::checkOverlapping2SidedSurface(std::istream &in)
     if (!m_overlapping_2_sided_surface)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkOverlapping2SidedSurface", Profiler::Trace::yes);
+
     std::chrono::system_clock::time_point start;
 
     if (m_show_times)
     {
-        std::cout << "checkOverlapping2SidedSurface starting" << std::endl;
+        *m_out << "checkOverlapping2SidedSurface starting" << std::endl;
         start = std::chrono::system_clock::now();
     }
 
     std::vector<Poly> polys;
     const Matrix matrix;
 
-    for (auto &world : m_objects)
-        addPoly(polys, world, matrix);
+    {
+        const Profiler::Scope broad(m_profiler, "overlapBroadPhase", Profiler::Trace::yes);
+
+        for (auto &world : m_objects)
+            addPoly(polys, world, matrix);
+    }
 
     if (polys.empty())
         return;
 
-    const int size1 = static_cast<int>(polys.size() - 1);
-    const int size2 = static_cast<int>(polys.size());
-    for (int i = 0; i < size1; ++i)
+    // find the overlaps in parallel but report them in the same order
+    // as checking the pairs one at a time would
+    std::vector<std::vector<Overlap>> overlaps(polys.size() - 1);
+
+    threadPool().parallelFor(0, polys.size() - 1, [this, &polys, &overlaps](size_t i)
+    {
+        Profiler::Scope narrow(m_profiler, "overlapNarrowPhase", Profiler::Trace::yes);
+
+        if (!polys[i].object->names.empty())
+            narrow.arg(polys[i].object->names.back().name);
+
+        Stats::Counts *counts = Stats::counts(m_stats);
+
+        for (size_t j = i + 1; j < polys.size(); ++j)
+            findOverlapping2SidedSurface(polys[i], polys[j], overlaps[i], counts);
+    });
+
+    for (const auto &poly_overlaps : overlaps)
     {
-        for (int j = i + 1; j < size2; ++j)
-            checkOverlapping2SidedSurface(in, polys[i], polys[j]);
+        for (const auto &overlap : poly_overlaps)
+            checkOverlapping2SidedSurface(in, overlap);
     }
 
     if (m_show_times)
     {
         const std::chrono::system_clock::time_point end = std::chrono::system_clock::now();
-        std::cout << "checkOverlapping2SidedSurface done: duration: " << getDuration(start, end) << std::endl;
+        *m_out << "checkOverlapping2SidedSurface done: duration: " << getDuration(start, end) << std::endl;
     }
 }
 
@@ -3586,14 +4278,24 @@ void AC3D::checkDuplicateTriangles(std::istream &in, const Object &object)
     if (!m_duplicate_triangles)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkDuplicateTriangles");
+
     if (m_is_ac)
         return;
 
     if (object.surfaces.empty())
         return;
 
+    // like checkDuplicateVertices()
+    const bool stop = !totalsShown();
+    size_t pairs = 0;
+    Stats::Counts *counts = Stats::counts(m_stats);
+
     for (size_t i = 0, endi = object.surfaces.size() - 1; i < endi; ++i)
     {
+        if (stop && limitReached(m_duplicate_triangles_count))
+            break;
+
         const Surface &surface1 = object.surfaces[i];
 
         for (size_t j = i + 1; j < object.surfaces.size(); ++j)
@@ -3612,6 +4314,8 @@ void AC3D::checkDuplicateTriangles(std::istream &in, const Object &object)
                         {
                             const Triangle &triangle2 = surface2.triangleStrip[l];
 
+                            pairs++;
+
                             if (triangle1.sameTriangle(triangle2, Difference::None))
                             {
                                 warningWithCount(m_duplicate_triangles_count, surface2.line_number) << "duplicate triangle" << std::endl;
@@ -3649,6 +4353,8 @@ void AC3D::checkDuplicateTriangles(std::istream &in, const Object &object)
                     }
                     else if (surface2.isTriangle())
                     {
+                        pairs++;
+
                         if (triangle1.sameTriangle(object, surface2, Difference::None))
                         {
                             warningWithCount(m_duplicate_triangles_count, surface2.line_number) << "duplicate triangle" << std::endl;
@@ -3691,6 +4397,8 @@ void AC3D::checkDuplicateTriangles(std::istream &in, const Object &object)
                 {
                     const Triangle &triangle2 = surface2.triangleStrip[k];
 
+                    pairs++;
+
                     if (triangle2.sameTriangle(object, surface1, Difference::None))
                     {
                         warningWithCount(m_duplicate_triangles_count, surface2.line_number) << "duplicate triangle" << std::endl;
@@ -3728,6 +4436,8 @@ void AC3D::checkDuplicateTriangles(std::istream &in, const Object &object)
             }
         }
     }
+
+    Stats::add(counts, Stats::duplicate_triangles_pairs, pairs);
 }
 
 void AC3D::checkMissingSurfaces(std::istream &in, const Object &object)
@@ -3735,6 +4445,8 @@ void AC3D::checkMissingSurfaces(std::istream &in, const Object &object)
     if (!m_missing_surfaces)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkMissingSurfaces");
+
     if (object.type.type != "poly")
         return;
 
@@ -3747,9 +4459,14 @@ void AC3D::checkMissingSurfaces(std::istream &in, const Object &object)
 
 void AC3D::checkDuplicateSurfaces(std::istream &in, const Object &object)
 {
+    const Profiler::Scope scope(m_profiler, "checkDuplicateSurfaces");
+
     if (object.surfaces.empty())
         return;
 
+    Stats::add(Stats::counts(m_stats), Stats::duplicate_surfaces_pairs,
+               object.surfaces.size() * (object.surfaces.size() - 1) / 2);
+
     for (size_t i = 0, endi = object.surfaces.size(); i < endi; ++i)
     {
         for (size_t j = i + 1; j < object.surfaces.size(); ++j)
@@ -3792,6 +4509,8 @@ void AC3D::checkUnusedVertex(std::istream &in, const Object &object)
     if (!m_unused_vertex)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkUnusedVertex");
+
     for (const auto &vertex : object.vertices)
     {
         if (!vertex.used)
@@ -3807,6 +4526,8 @@ void AC3D::checkDifferentSURF(std::istream &in, const Object &object)
     if (!m_different_surf)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkDifferentSURF");
+
     if (object.surfaces.empty())
         return;
 
@@ -3829,6 +4550,8 @@ void AC3D::checkDifferentMat(std::istream &in, const Object &object)
     if (!m_different_mat)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkDifferentMat");
+
     if (object.surfaces.empty())
         return;
 
@@ -3879,6 +4602,8 @@ void AC3D::checkDifferentUV(std::istream &in, const Object &object)
     if (!m_different_uv)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkDifferentUV");
+
     // only check texture coordinates when texture is present
     if (object.textures.empty() || object.textures[0].name == "empty_texture_no_mapping")
         return;
@@ -3962,6 +4687,8 @@ void AC3D::checkGroupWithGeometry(std::istream &in, const Object &object)
     if (!m_group_with_geometry)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkGroupWithGeometry");
+
     if (object.type.type == "group" && !object.vertices.empty())
     {
         warningWithCount(m_group_with_geometry_count, object.type.line_number) << "group with geometry" << std::endl;
@@ -3973,9 +4700,14 @@ void AC3D::checkGroupWithGeometry(std::istream &in, const Object &object)
 
 void AC3D::checkDuplicateSurfaceVertices(std::istream &in, const Object &object, Surface &surface)
 {
+    const Profiler::Scope scope(m_profiler, "checkDuplicateSurfaceVertices");
+
     if (surface.refs.empty())
         return;
 
+    Stats::add(Stats::counts(m_stats), Stats::duplicate_surface_vertices_pairs,
+               surface.refs.size() * (surface.refs.size() - 1) / 2);
+
     for (size_t i = 0, endi = surface.refs.size() - 1; i < endi; ++i)
     {
         for (size_t j = i + 1; j < surface.refs.size(); ++j)
@@ -4044,10 +4776,26 @@ void AC3D::checkDuplicateVertices(std::istream &in, const Object &object)
     if (!m_duplicate_vertices)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkDuplicateVertices");
+
+    // This check only reports so it can stop when no more will be shown
+    // unless the totals need the count.
+    const bool stop = !totalsShown();
+
+    if (stop && limitReached(m_duplicate_vertices_count))
+        return;
+
     std::vector<bool> duplicates(object.vertices.size(), false);
 
+    // counted here and added once so the inner loop stays tight
+    size_t pairs = 0;
+    size_t found = 0;
+    Stats::Counts *counts = Stats::counts(m_stats);
+
     for (size_t i = 0; i < object.vertices.size(); i++)
     {
+        pairs += object.vertices.size() - i - 1;
+
         for (size_t j = i + 1; j < object.vertices.size(); j++)
         {
             // already reported as a duplicate of an earlier vertex
@@ -4057,14 +4805,27 @@ void AC3D::checkDuplicateVertices(std::istream &in, const Object &object)
             if (object.vertices[i] == object.vertices[j])
             {
                 duplicates[j] = true;
+                found++;
 
                 warningWithCount(m_duplicate_vertices_count, object.vertices[j].line_number) << "duplicate vertices" << std::endl;
                 showLine(in, object.vertices[j].line_pos);
                 note(object.vertices[i].line_number) << "first instance" << std::endl;
                 showLine(in, object.vertices[i].line_pos);
+
+                if (stop && limitReached(m_duplicate_vertices_count))
+                {
+                    // the rest of the row wasn't looked at
+                    pairs -= object.vertices.size() - j - 1;
+                    Stats::add(counts, Stats::duplicate_vertices_pairs, pairs);
+                    Stats::add(counts, Stats::duplicate_vertices_found, found);
+                    return;
+                }
             }
         }
     }
+
+    Stats::add(counts, Stats::duplicate_vertices_pairs, pairs);
+    Stats::add(counts, Stats::duplicate_vertices_found, found);
 }
 
 bool AC3D::collinear(const Point3 &p1, const Point3 &p2, const Point3 &p3)
@@ -4091,6 +4852,8 @@ bool AC3D::collinear(const Point3 &p1, const Point3 &p2, const Point3 &p3)
 
 void AC3D::checkCollinearSurfaceVertices(std::istream &in, const Object &object, Surface &surface)
 {
+    const Profiler::Scope scope(m_profiler, "checkCollinearSurfaceVertices");
+
     const size_t size = surface.refs.size();
     size_t found = 0;
 
@@ -4145,6 +4908,8 @@ void AC3D::checkCollinearSurfaceVertices(std::istream &in, const Object &object,
 
 void AC3D::checkSurfaceCoplanar(std::istream &in, const Object &object, Surface &surface)
 {
+    const Profiler::Scope scope(m_profiler, "checkSurfaceCoplanar");
+
     // only check polygon
     if (!surface.isPolygon())
         return;
@@ -4241,6 +5006,8 @@ void AC3D::checkSurfaceNoTexture(std::istream &in, const Object &object, const S
     if (!m_surface_no_texture)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkSurfaceNoTexture");
+
     if (!(surface.isPolygon() || surface.isTriangleStrip()))
         return;
 
@@ -4266,6 +5033,8 @@ void AC3D::checkSurfaceZeroAreaUV(std::istream &in, const Object &object, const
     if (!m_surface_zero_area_uv)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkSurfaceZeroAreaUV");
+
     // only meaningful when the surface actually has a texture to map
     if (object.textures.empty() || object.textures[0].name == "empty_texture_no_mapping")
         return;
@@ -4351,6 +5120,8 @@ void AC3D::checkSurface2SidedOpaque(std::istream &in, const Object &object, cons
     if (!m_surface_2_sided_opaque)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkSurface2SidedOpaque");
+
     if (!(surface.isPolygon() || surface.isTriangleStrip()))
         return;
 
@@ -4367,6 +5138,8 @@ void AC3D::checkSurface2SidedOpaque(std::istream &in, const Object &object, cons
 
 void AC3D::checkSurfacePolygonType(std::istream &in, const Object &object, Surface &surface)
 {
+    const Profiler::Scope scope(m_profiler, "checkSurfacePolygonType");
+
     // only check coplanar polygon
     if (!(surface.isPolygon() && surface.coplanar))
         return;
@@ -4543,6 +5316,27 @@ bool AC3D::pointInCoplanarTriangle(const Point3 &point, const Triangle &triangle
            (d1 < -epsilon && d2 < -epsilon && d3 < -epsilon);
 }
 
+// The boxes are made larger by twice the epsilon boundingBoxesOverlap()
+// would use for this triangle. It uses the larger epsilon of the pair on
+// both boxes so the gap it allows is 2 * max(epsilon1, epsilon2) which is
+// never more than 2 * epsilon1 + 2 * epsilon2. The float boxes can only
+// find more pairs overlapping, which trianglesOverlap() then decides.
+void AC3D::addBoundingBox(BoundingBoxes &boxes, const Triangle &triangle)
+{
+    constexpr double k = 4.0;
+    const double float_epsilon = static_cast<double>(std::numeric_limits<float>::epsilon());
+
+    const double scale = std::max({
+        triangle.boxMax.x() - triangle.boxMin.x(), triangle.boxMax.y() - triangle.boxMin.y(), triangle.boxMax.z() - triangle.boxMin.z(),
+        std::fabs(triangle.boxMin.x()), std::fabs(triangle.boxMin.y()), std::fabs(triangle.boxMin.z()),
+        1.0
+        });
+    const double epsilon = 2.0 * k * float_epsilon * scale;
+
+    boxes.add(triangle.boxMin.x() - epsilon, triangle.boxMin.y() - epsilon, triangle.boxMin.z() - epsilon,
+              triangle.boxMax.x() + epsilon, triangle.boxMax.y() + epsilon, triangle.boxMax.z() + epsilon);
+}
+
 bool AC3D::boundingBoxesOverlap(const Triangle &triangle1, const Triangle &triangle2)
 {
     constexpr double k = 4.0;
@@ -4567,21 +5361,109 @@ bool AC3D::boundingBoxesOverlap(const Triangle &triangle1, const Triangle &trian
         (triangle2.boxMin.z() - epsilon <= triangle1.boxMax.z() + epsilon);
 }
 
-bool AC3D::trianglesOverlap(const Triangle &triangle1, const Triangle &triangle2)
+// The edges are found in double and rounded to float so the error doesn't
+// depend on how far the triangle is from the origin. Each component of
+// their cross product is then within 8u|e1||e2| of the exact one, where u
+// is 2^-24, and the normalized normal within 16u|e1||e2|/|c| + 4u. The
+// error used is twice that, which also covers the rounding of the double
+// normal. The distance is the float normal dotted with the first vertex
+// in double so its error is 3 * error * the vertex's largest coordinate,
+// doubled again, plus rounding it to float. Thin triangles, where
+// |e1||e2|/|c| is large, get a large error and are left to coplanar(). So
+// are the ones Plane doesn't normalize.
+AC3D::FloatPlane AC3D::floatPlane(const Triangle &triangle)
+{
+    const Point3 &vertex = triangle.vertices[0].vertex;
+    const Point3 edge1 = triangle.vertices[1].vertex - vertex;
+    const Point3 edge2 = triangle.vertices[2].vertex - vertex;
+
+    const float x1 = static_cast<float>(edge1.x());
+    const float y1 = static_cast<float>(edge1.y());
+    const float z1 = static_cast<float>(edge1.z());
+    const float x2 = static_cast<float>(edge2.x());
+    const float y2 = static_cast<float>(edge2.y());
+    const float z2 = static_cast<float>(edge2.z());
+
+    const float cx = y1 * z2 - z1 * y2;
+    const float cy = z1 * x2 - x1 * z2;
+    const float cz = x1 * y2 - y1 * x2;
+
+    const float length = std::sqrt(cx * cx + cy * cy + cz * cz);
+    const float edges = std::sqrt((x1 * x1 + y1 * y1 + z1 * z1) * (x2 * x2 + y2 * y2 + z2 * z2));
+
+    FloatPlane plane;
+
+    if (!(length > 2.0F * std::numeric_limits<float>::epsilon()) || !std::isfinite(edges))
+        return plane;
+
+    constexpr float u = std::numeric_limits<float>::epsilon() / 2.0F;
+
+    plane.x = cx / length;
+    plane.y = cy / length;
+    plane.z = cz / length;
+    plane.error = 2.0F * (16.0F * u * edges / length + 4.0F * u);
+
+    const double distance = plane.x * vertex.x() + plane.y * vertex.y() + plane.z * vertex.z();
+    const double largest = std::max({ std::fabs(vertex.x()), std::fabs(vertex.y()), std::fabs(vertex.z()) });
+
+    plane.distance = static_cast<float>(distance);
+    plane.distance_error = static_cast<float>(2.0 * 3.0 * plane.error * largest + 2.0 * u * std::fabs(distance));
+
+    if (!std::isfinite(plane.distance) || !std::isfinite(plane.distance_error))
+        return FloatPlane();
+
+    return plane;
+}
+
+// True when Plane::equals() would be false: the normals are different or
+// the distances are, both when wound the same way and opposite ways. The
+// normals are unit length so Point3::equals() allows 4 * float epsilon.
+bool AC3D::notCoplanar(const FloatPlane &plane1, const FloatPlane &plane2)
+{
+    constexpr float margin = 1.0F + 1.0e-6F;
+    constexpr float k = 4.0F * std::numeric_limits<float>::epsilon();
+
+    const float limit = (k + plane1.error + plane2.error) * margin;
+    const float distance_limit = (k * std::max({ std::fabs(plane1.distance) + plane1.distance_error,
+                                                 std::fabs(plane2.distance) + plane2.distance_error, 1.0F }) +
+                                  plane1.distance_error + plane2.distance_error) * margin;
+
+    const float same = std::max({ std::fabs(plane1.x - plane2.x), std::fabs(plane1.y - plane2.y), std::fabs(plane1.z - plane2.z) });
+    const float opposite = std::max({ std::fabs(plane1.x + plane2.x), std::fabs(plane1.y + plane2.y), std::fabs(plane1.z + plane2.z) });
+
+    return (same > limit || std::fabs(plane1.distance - plane2.distance) > distance_limit) &&
+           (opposite > limit || std::fabs(plane1.distance + plane2.distance) > distance_limit);
+}
+
+bool AC3D::trianglesOverlap(const Triangle &triangle1, const Triangle &triangle2, Stats::Counts *counts,
+                            const FloatPlane *plane1, const FloatPlane *plane2)
 {
     if (!boundingBoxesOverlap(triangle1, triangle2))
+    {
+        Stats::add(counts, Stats::overlap_bounding_box_rejects);
         return false;
+    }
 
     if (getSharedVertexCount(triangle1, triangle2) == 3)
+    {
+        Stats::add(counts, Stats::overlap_shared_vertices);
         return true;
+    }
 
-    if (!coplanar(triangle1, triangle2))
+    // the float planes decide most pairs, the ones too close to call go to coplanar()
+    if ((plane1 != nullptr && plane2 != nullptr && notCoplanar(*plane1, *plane2)) ||
+        !coplanar(triangle1, triangle2))
+    {
+        Stats::add(counts, Stats::overlap_coplanar_rejects);
         return false;
+    }
 
     Point3 p1{ 0, 0, 0 }; // not used
     Point3 p2{ 0, 0, 0 }; // not used
     bool b = false; // not used
 
+    Stats::add(counts, Stats::overlap_triangle_intersects);
+
     if (threeyd::moeller::TriangleIntersects<Point3>::triangle(
         triangle1.vertices[0].vertex, triangle1.vertices[1].vertex, triangle1.vertices[2].vertex,
         triangle2.vertices[0].vertex, triangle2.vertices[1].vertex, triangle2.vertices[2].vertex,
@@ -4599,6 +5481,8 @@ bool AC3D::trianglesOverlap(const Triangle &triangle1, const Triangle &triangle2
     // the vertex that matters isn't vertex 0. Now that we already know
     // the two triangles are coplanar, cover that gap by testing every
     // vertex of each triangle for containment in the other.
+    Stats::add(counts, Stats::overlap_point_in_triangle);
+
     return pointInCoplanarTriangle(triangle1.vertices[0].vertex, triangle2) ||
            pointInCoplanarTriangle(triangle1.vertices[1].vertex, triangle2) ||
            pointInCoplanarTriangle(triangle1.vertices[2].vertex, triangle2) ||
@@ -4740,6 +5624,8 @@ void AC3D::checkSurfaceStripSize(std::istream &in, const Surface &surface)
     if (!m_surface_strip_size)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkSurfaceStripSize");
+
     if (m_is_ac)
         return;
 
@@ -4776,6 +5662,8 @@ void AC3D::checkSurfaceStripDuplicateTriangles(std::istream &in, const Surface &
     if (!m_surface_strip_duplicate_triangles)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkSurfaceStripDuplicateTriangles");
+
     if (m_is_ac)
         return;
 
@@ -4840,6 +5728,8 @@ void AC3D::checkSurfaceStripDegenerate(std::istream &in, const Surface &surface)
     if (!m_surface_strip_degenerate)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkSurfaceStripDegenerate");
+
     if (m_is_ac)
         return;
 
@@ -4868,6 +5758,8 @@ void AC3D::checkSurfaceStripHole(std::istream &in, const Surface &surface)
     if (!m_surface_strip_hole)
         return;
 
+    const Profiler::Scope scope(m_profiler, "checkSurfaceStripHole");
+
     if (m_is_ac)
         return;
 
@@ -4937,6 +5829,8 @@ void AC3D::checkSurfaceStripHole(std::istream &in, const Surface &surface)
 
 void AC3D::checkSurfaceSelfIntersecting(std::istream &in, const Object &object, const Surface &surface)
 {
+    const Profiler::Scope scope(m_profiler, "checkSurfaceSelfIntersecting");
+
     // only check coplanar polygon
     if (!(surface.isPolygon() && surface.coplanar))
         return;
@@ -4945,6 +5839,9 @@ void AC3D::checkSurfaceSelfIntersecting(std::istream &in, const Object &object,
     {
         const size_t size = surface.refs.size();
         const size_t count = size - 2;
+        Stats::Counts *counts = Stats::counts(m_stats);
+
+        Stats::add(counts, Stats::self_intersecting_surfaces);
 
         for (size_t j = 0; j < count; j++)
         {
@@ -4988,6 +5885,7 @@ void AC3D::checkSurfaceSelfIntersecting(std::istream &in, const Object &object,
             {
                 if (next - j >= size)
                     return;
+                Stats::add(counts, Stats::self_intersecting_skipped_vertices);
                 end--;
                 next++;
                 p1 = p2;
@@ -5033,6 +5931,7 @@ void AC3D::checkSurfaceSelfIntersecting(std::istream &in, const Object &object,
                     // function.
                     if (next - j >= size)
                         return;
+                    Stats::add(counts, Stats::self_intersecting_skipped_vertices);
                     end--;
                     next++;
                     p3 = p4;
@@ -5042,6 +5941,8 @@ void AC3D::checkSurfaceSelfIntersecting(std::istream &in, const Object &object,
 
                 if (next <= end)
                 {
+                    Stats::add(counts, Stats::self_intersecting_segment_pairs);
+
                     const double distance = closest(p0, p1, p2, p3);
 
                     // `distance` is a raw-coordinate-scale quantity (the
@@ -5077,7 +5978,15 @@ void AC3D::checkSurfaceSelfIntersecting(std::istream &in, const Object &object,
 
 bool AC3D::write(const std::string &file, int version)
 {
-    const std::string extension = std::filesystem::path(file).extension().string();
+    const Profiler::Scope scope(m_profiler, "write", Profiler::Trace::yes);
+
+    std::filesystem::path path(file);
+    const bool compress = path.extension() == ".gz";
+
+    if (compress)
+        path = path.stem();
+
+    const std::string extension = path.extension().string();
     bool is_ac;
 
     if (extension == ".ac")
@@ -5086,7 +5995,7 @@ bool AC3D::write(const std::string &file, int version)
         is_ac = false;
     else
     {
-        std::cerr << "Unknown file extension: \"" << extension << "\"" << std::endl;
+        message() << "Unknown file extension: \"" << extension << "\"" << std::endl;
         return false;
     }
 
@@ -5095,11 +6004,26 @@ bool AC3D::write(const std::string &file, int version)
     else if (!m_is_ac && is_ac) // convert .acc to .ac
         convertObjectsToAc(m_objects);
 
+    // before the output file is opened because it may be the input file
+    if (m_copy_unchanged)
+        readSource();
+
     std::ofstream of(file, std::ofstream::binary);
 
     if (!of)
         return false;
 
+    std::optional<GzipStreamBuf> gzip;
+    std::ostream gzip_out(nullptr);
+
+    if (compress)
+    {
+        gzip.emplace(of.rdbuf(), m_compression_level);
+        gzip_out.rdbuf(&*gzip);
+    }
+
+    Writer out(compress ? gzip_out : of);
+
     if (version == 12)
     {
         m_header.version = "AC3Dc";
@@ -5115,14 +6039,24 @@ bool AC3D::write(const std::string &file, int version)
             material.version12 = false;
     }
 
-    writeHeader(of, m_header);
+    writeHeader(out, m_header);
 
     for (const auto &material : m_materials)
-        writeMaterial(of, material);
+        writeMaterial(out, material);
 
     for (const auto &object : m_objects)
-        writeObject(of, object);
-
+    {
+        writeObjectData(out, object);
+        writeKids(out, object);
+    }
+
+    out.flush();
+
+    std::string().swap(m_source);
+
+    if (gzip && !gzip->finish())
+        return false;
+
     return true;
 }
 
@@ -5167,26 +6101,45 @@ bool AC3D::setMaterialUsed(size_t index)
 
 bool AC3D::clean()
 {
+    const Profiler::Scope scope(m_profiler, "clean", Profiler::Trace::yes);
+
     std::chrono::system_clock::time_point start;
 
     if (m_show_times)
     {
-        std::cout << "clean starting" << std::endl;
+        *m_out << "clean starting" << std::endl;
         start = std::chrono::system_clock::now();
     }
 
-    bool cleaned = false;
+    // cleanMaterials only changes the surface materials and cleanVertices
+    // only changes the vertices and surface refs so they can run at the
+    // same time but everything after them needs both to be done
+    bool materials = false;
+    bool vertices = false;
+    bool surfaces = false;
+    bool unused_vertices = false;
+    bool objects = false;
+    TaskGraph graph;
+
+    const size_t clean_materials = graph.add([this, &materials] { materials = cleanMaterials(); });
+    const size_t clean_vertices = graph.add([this, &vertices] { vertices = cleanVertices(); });
+    const size_t clean_surfaces = graph.add([this, &surfaces] { surfaces = cleanSurfaces(); });
+    const size_t clean_unused_vertices = graph.add([this, &unused_vertices] { unused_vertices = cleanVertices(); }); // cleanSurfaces may create unused vertices
+    const size_t clean_objects = graph.add([this, &objects] { objects = cleanObjects(); });
 
-    cleaned |= cleanMaterials();
-    cleaned |= cleanVertices();
-    cleaned |= cleanSurfaces();
-    cleaned |= cleanVertices(); // cleanSurfaces may create unused vertices
-    cleaned |= cleanObjects();
+    graph.precede(clean_materials, clean_surfaces);
+    graph.precede(clean_vertices, clean_surfaces);
+    graph.precede(clean_surfaces, clean_unused_vertices);
+    graph.precede(clean_unused_vertices, clean_objects);
+
+    graph.run(threadPool());
+
+    const bool cleaned = materials || vertices || surfaces || unused_vertices || objects;
 
     if (m_show_times)
     {
         const std::chrono::system_clock::time_point end = std::chrono::system_clock::now();
-        std::cout << "clean done: duration: " << getDuration(start, end) << std::endl;
+        *m_out << "clean done: duration: " << getDuration(start, end) << std::endl;
     }
 
     return cleaned;
@@ -5194,6 +6147,8 @@ bool AC3D::clean()
 
 bool AC3D::splitMultipleSURF()
 {
+    const Profiler::Scope scope(m_profiler, "splitMultipleSURF", Profiler::Trace::yes);
+
     return splitMultipleSURF(m_objects);
 }
 
@@ -5265,6 +6220,8 @@ bool AC3D::splitMultipleSURF(std::vector<Object> &kids)
 
 bool AC3D::splitMultipleMat()
 {
+    const Profiler::Scope scope(m_profiler, "splitMultipleMat", Profiler::Trace::yes);
+
     return splitMultipleMat(m_objects);
 }
 
@@ -5342,6 +6299,8 @@ bool AC3D::splitMultipleMat(std::vector<Object> &kids)
 
 bool AC3D::fixMultipleWorlds()
 {
+    const Profiler::Scope scope(m_profiler, "fixMultipleWorlds", Profiler::Trace::yes);
+
     // check for concatenated files
     if (!(m_objects.size() == 2 && m_objects[0].type.type == "world" && m_objects[1].type.type == "world"))
         return false;
@@ -5364,7 +6323,7 @@ bool AC3D::fixMultipleWorlds()
     if (materials != 0)
     {
         // TODO: change material index of concatenated file surfaces if necessary
-        std::cerr << "Can't fix concatenated world with materials yet" << std::endl;
+        message() << "Can't fix concatenated world with materials yet" << std::endl;
         return false;
     }
 
@@ -5377,6 +6336,8 @@ bool AC3D::fixMultipleWorlds()
 
 bool AC3D::cleanMaterials()
 {
+    const Profiler::Scope scope(m_profiler, "cleanMaterials", Profiler::Trace::yes);
+
     bool cleaned = false;
 
     for (auto &material : m_materials)
@@ -5481,7 +6442,8 @@ bool AC3D::cleanMaterials(std::vector<Object> &objects, const std::vector<size_t
     {
         for (auto &surface : object.surfaces)
         {
-            if (!surface.mats.empty() &&
+            // invalid indexes were already reported and are left alone
+            if (!surface.mats.empty() && surface.mats.back().mat < indexes.size() &&
                 surface.mats.back().mat != indexes[surface.mats.back().mat])
             {
                 changed = true;
@@ -5499,6 +6461,8 @@ bool AC3D::cleanMaterials(std::vector<Object> &objects, const std::vector<size_t
 
 bool AC3D::cleanObjects()
 {
+    const Profiler::Scope scope(m_profiler, "cleanObjects", Profiler::Trace::yes);
+
     return cleanObjects(m_objects);
 }
 
@@ -5536,36 +6500,36 @@ bool AC3D::cleanObjects(std::vector<Object> &objects)
 
 bool AC3D::cleanVertices()
 {
+    const Profiler::Scope scope(m_profiler, "cleanVertices", Profiler::Trace::yes);
+
     std::chrono::system_clock::time_point start;
 
     if (m_show_times)
     {
-        std::cout << "cleanVertices starting" << std::endl;
+        *m_out << "cleanVertices starting" << std::endl;
         start = std::chrono::system_clock::now();
     }
 
-    const bool result = cleanVertices(m_objects);
+    std::vector<Object *> objects;
 
-    if (m_show_times)
-    {
-        const std::chrono::system_clock::time_point end = std::chrono::system_clock::now();
-        std::cout << "cleanVertices done: duration: " << getDuration(start, end) << std::endl;
-    }
+    getAllObjects(objects, m_objects);
 
-    return result;
-}
+    // each object has its own vertices so they can be cleaned in parallel
+    std::atomic<bool> result = false;
 
-bool AC3D::cleanVertices(std::vector<Object> &objects)
-{
-    bool cleaned = false;
+    threadPool().parallelFor(0, objects.size(), [&objects, &result](size_t i)
+    {
+        if (cleanVertices(*objects[i]))
+            result = true;
+    });
 
-    for (auto &object : objects)
+    if (m_show_times)
     {
-        cleaned |= cleanVertices(object);
-        cleaned |= cleanVertices(object.kids);
+        const std::chrono::system_clock::time_point end = std::chrono::system_clock::now();
+        *m_out << "cleanVertices done: duration: " << getDuration(start, end) << std::endl;
     }
 
-    return cleaned;
+    return result;
 }
 
 bool AC3D::cleanVertices(Object &object)
@@ -5669,6 +6633,17 @@ bool AC3D::cleanVertices(Object &object)
     return true;
 }
 
+ThreadPool &AC3D::threadPool()
+{
+    if (m_thread_pool != nullptr)
+        return *m_thread_pool;
+
+    if (!m_own_thread_pool)
+        m_own_thread_pool = std::make_unique<ThreadPool>(m_threads);
+
+    return *m_own_thread_pool;
+}
+
 void AC3D::getObjects(std::vector<Object *> &polys, Object *object)
 {
     if (object->type.type == "poly")
@@ -5684,37 +6659,47 @@ void AC3D::getObjects(std::vector<Object *> &polys, Object *object)
     }
 }
 
+void AC3D::getAllObjects(std::vector<Object *> &objects, std::vector<Object> &kids)
+{
+    for (auto &kid : kids)
+    {
+        objects.push_back(&kid);
+        getAllObjects(objects, kid.kids);
+    }
+}
+
 bool AC3D::cleanSurfaces()
 {
+    const Profiler::Scope scope(m_profiler, "cleanSurfaces", Profiler::Trace::yes);
+
     std::vector<Object *> polys;
 
     // find all the polys
     for (auto &object : m_objects)
         getObjects(polys, &object);
 
-    bool cleaned = false;
-
+    ThreadPool &pool = threadPool();
     std::chrono::system_clock::time_point start;
 
     if (m_show_times)
     {
-        std::cout << "cleanSurfaces starting with " << m_threads << " thread" << (m_threads > 1 ? "s" : "") << std::endl;
+        *m_out << "cleanSurfaces starting with " << pool.threads() << " thread" << (pool.threads() > 1 ? "s" : "") << std::endl;
         start = std::chrono::system_clock::now();
     }
 
     // clean them
-    const int size = static_cast<int>(polys.size());
+    std::atomic<bool> cleaned = false;
 
-    #pragma omp parallel for reduction(|:cleaned) num_threads(m_threads)
-    for (int i = 0; i < size; i++)
+    pool.parallelFor(0, polys.size(), [&polys, &cleaned](size_t i)
     {
-        cleaned |= cleanSurfaces(*polys[i]);
-    }
+        if (cleanSurfaces(*polys[i]))
+            cleaned = true;
+    });
 
     if (m_show_times)
     {
         const std::chrono::system_clock::time_point end = std::chrono::system_clock::now();
-        std::cout << "cleanSurfaces done: duration: " << getDuration(start, end) << std::endl;
+        *m_out << "cleanSurfaces done: duration: " << getDuration(start, end) << std::endl;
     }
 
     return cleaned;
@@ -5822,12 +6807,273 @@ void AC3D::dump(DumpType dump_type) const
 {
     for (size_t i = 0; i < m_objects.size(); i++)
     {
-        m_objects[i].dump(dump_type, i, 0);
+        m_objects[i].dump(*m_out, dump_type, i, 0);
+    }
+}
+
+namespace
+{
+
+// the bytes a string has on the heap, none when it fits inside it
+size_t heapBytes(const std::string &s)
+{
+    const char *data = s.data();
+    const char *begin = reinterpret_cast<const char *>(&s);
+
+    if (!std::less<const char *>()(data, begin) && std::less<const char *>()(data, begin + sizeof(s)))
+        return 0;
+
+    return s.capacity() + 1;
+}
+
+template <typename T>
+size_t arrayBytes(const std::vector<T> &v)
+{
+    return v.capacity() * sizeof(T);
+}
+
+} // namespace
+
+AC3D::Memory &AC3D::Memory::operator += (const Memory &memory)
+{
+    vertices += memory.vertices;
+    refs += memory.refs;
+    coordinates += memory.coordinates;
+    triangle_strips += memory.triangle_strips;
+    transformed_triangles += memory.transformed_triangles;
+    materials += memory.materials;
+    strings += memory.strings;
+    line_info += memory.line_info;
+    other += memory.other;
+
+    return *this;
+}
+
+// The arrays of things with a line number are split between what they are
+// and the line numbers. An object itself is counted by the array of kids
+// it is in.
+void AC3D::addMemory(const Object &object, Memory &memory)
+{
+    // the line numbers of count things with lines line numbers each
+    const auto lineInfo = [&memory](size_t count, size_t lines = 1)
+    {
+        memory.line_info += count * lines * sizeof(LineInfo);
+        return count * lines * sizeof(LineInfo);
+    };
+
+    const auto triangles = [&lineInfo](const std::vector<Triangle> &triangles)
+    {
+        // 3 vertices and 3 refs
+        size_t bytes = arrayBytes(triangles) - lineInfo(triangles.size(), 6);
+
+        for (const auto &triangle : triangles)
+        {
+            for (const auto &ref : triangle.refs)
+                bytes += arrayBytes(ref.coordinates);
+        }
+
+        return bytes;
+    };
+
+    memory.strings += heapBytes(object.type.type);
+
+    memory.strings += arrayBytes(object.names) - lineInfo(object.names.size());
+    for (const auto &name : object.names)
+        memory.strings += heapBytes(name.name);
+
+    memory.strings += arrayBytes(object.urls) - lineInfo(object.urls.size());
+    for (const auto &url : object.urls)
+        memory.strings += heapBytes(url.url);
+
+    memory.strings += arrayBytes(object.data) - lineInfo(object.data.size());
+    for (const auto &data : object.data)
+        memory.strings += heapBytes(data.data);
+
+    memory.strings += arrayBytes(object.shaders) - lineInfo(object.shaders.size());
+    for (const auto &shader : object.shaders)
+        memory.strings += heapBytes(shader.name);
+
+    memory.strings += arrayBytes(object.textures) - lineInfo(object.textures.size());
+    for (const auto &texture : object.textures)
+        memory.strings += heapBytes(texture.name) + heapBytes(texture.type) + heapBytes(texture.path);
+
+    memory.other += arrayBytes(object.texreps) - lineInfo(object.texreps.size());
+    memory.other += arrayBytes(object.texoffs) - lineInfo(object.texoffs.size());
+    memory.other += arrayBytes(object.subdivs) - lineInfo(object.subdivs.size());
+    memory.other += arrayBytes(object.locations) - lineInfo(object.locations.size());
+    memory.other += arrayBytes(object.rotations) - lineInfo(object.rotations.size());
+    memory.other += arrayBytes(object.creases) - lineInfo(object.creases.size());
+    memory.other += arrayBytes(object.hidden) - lineInfo(object.hidden.size());
+    memory.other += arrayBytes(object.locked) - lineInfo(object.locked.size());
+    memory.other += arrayBytes(object.folded) - lineInfo(object.folded.size());
+
+    memory.vertices += arrayBytes(object.vertices) - lineInfo(object.vertices.size());
+
+    // the surface and its refs have line numbers
+    memory.other += arrayBytes(object.surfaces) - lineInfo(object.surfaces.size(), 2);
+
+    for (const auto &surface : object.surfaces)
+    {
+        memory.other += arrayBytes(surface.mats) - lineInfo(surface.mats.size());
+        memory.refs += arrayBytes(surface.refs) - lineInfo(surface.refs.size());
+
+        for (const auto &ref : surface.refs)
+            memory.coordinates += arrayBytes(ref.coordinates);
+
+        memory.triangle_strips += triangles(surface.triangleStrip);
+        memory.transformed_triangles += triangles(surface.transformedTriangles);
+    }
+
+    // the object, its type, numvert and numsurf have line numbers
+    memory.other += arrayBytes(object.kids) - lineInfo(object.kids.size(), 4);
+
+    for (const auto &kid : object.kids)
+        addMemory(kid, memory);
+}
+
+size_t AC3D::peakMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+
+    return 0;
+#else
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+void AC3D::memoryReport(const std::string &phase) const
+{
+    struct Row
+    {
+        std::string name;
+        Memory      memory;
+    };
+
+    // the biggest objects, the rest are added together
+    constexpr size_t max_rows = 20;
+
+    std::vector<Row> rows;
+    Memory materials;
+    Memory total;
+
+    materials.materials += arrayBytes(m_materials) - m_materials.size() * sizeof(LineInfo);
+    materials.line_info += m_materials.size() * sizeof(LineInfo);
+
+    for (const auto &material : m_materials)
+    {
+        materials.materials += heapBytes(material.name) + arrayBytes(material.data) - material.data.size() * sizeof(LineInfo);
+        materials.line_info += material.data.size() * sizeof(LineInfo);
+
+        for (const auto &data : material.data)
+            materials.materials += heapBytes(data.data);
+    }
+
+    total += materials;
+
+    for (size_t i = 0; i < m_objects.size(); ++i)
+    {
+        const Object &world = m_objects[i];
+        Memory kids;
+
+        for (size_t j = 0; j < world.kids.size(); ++j)
+        {
+            const Object &kid = world.kids[j];
+            std::ostringstream name;
+
+            name << (j + 1) << " " << kid.type.type;
+            if (!kid.names.empty())
+                name << " " << kid.names.back().name;
+
+            rows.push_back({ name.str(), Memory() });
+            addMemory(kid, rows.back().memory);
+            kids += rows.back().memory;
+        }
+
+        // what's left is the world itself
+        Memory all;
+
+        addMemory(world, all);
+        total += all;
+
+        Row row{ std::to_string(i + 1) + " " + world.type.type, Memory() };
+
+        row.memory.vertices = all.vertices - kids.vertices;
+        row.memory.refs = all.refs - kids.refs;
+        row.memory.coordinates = all.coordinates - kids.coordinates;
+        row.memory.triangle_strips = all.triangle_strips - kids.triangle_strips;
+        row.memory.transformed_triangles = all.transformed_triangles - kids.transformed_triangles;
+        row.memory.strings = all.strings - kids.strings;
+        row.memory.line_info = all.line_info - kids.line_info;
+        row.memory.other = all.other - kids.other + sizeof(Object);
+
+        total.other += sizeof(Object);
+        rows.push_back(row);
+    }
+
+    std::stable_sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) { return a.memory.total() > b.memory.total(); });
+
+    if (rows.size() > max_rows)
+    {
+        Row others{ std::to_string(rows.size() - max_rows + 1) + " others", Memory() };
+
+        for (size_t i = max_rows - 1; i < rows.size(); ++i)
+            others.memory += rows[i].memory;
+
+        rows.resize(max_rows - 1);
+        rows.push_back(others);
+    }
+
+    rows.push_back({ "materials", materials });
+    rows.push_back({ "total", total });
+
+    std::ostream &out = *m_out;
+
+    out << "memory after " << phase << ": " << total.total() << " bytes, peak memory: " << peakMemory() << " bytes" << std::endl;
+    out << std::left << std::setw(32) << "object" << std::right
+        << std::setw(12) << "vertices"
+        << std::setw(12) << "refs"
+        << std::setw(12) << "uv"
+        << std::setw(12) << "strips"
+        << std::setw(12) << "triangles"
+        << std::setw(12) << "materials"
+        << std::setw(12) << "strings"
+        << std::setw(12) << "line info"
+        << std::setw(12) << "other"
+        << std::setw(12) << "total" << std::endl;
+
+    for (const auto &row : rows)
+    {
+        out << std::left << std::setw(32) << row.name.substr(0, 31) << std::right
+            << std::setw(12) << row.memory.vertices
+            << std::setw(12) << row.memory.refs
+            << std::setw(12) << row.memory.coordinates
+            << std::setw(12) << row.memory.triangle_strips
+            << std::setw(12) << row.memory.transformed_triangles
+            << std::setw(12) << row.memory.materials
+            << std::setw(12) << row.memory.strings
+            << std::setw(12) << row.memory.line_info
+            << std::setw(12) << row.memory.other
+            << std::setw(12) << row.memory.total() << std::endl;
     }
 }
 
 bool AC3D::merge(const AC3D &ac3d)
 {
+    const Profiler::Scope scope(m_profiler, "merge", Profiler::Trace::yes);
+
     if (m_objects.size() != 1 || m_objects[0].type.type != "world" ||
         ac3d.m_objects.size() != 1 || ac3d.m_objects[0].type.type != "world")
     {
@@ -5839,6 +7085,7 @@ bool AC3D::merge(const AC3D &ac3d)
 
     m_materials.insert(m_materials.end(), ac3d.m_materials.begin(), ac3d.m_materials.end());
     m_objects[0].kids.insert(m_objects[0].kids.end(), ac3d.m_objects[0].kids.begin(), ac3d.m_objects[0].kids.end());
+    m_texture_files.insert(ac3d.m_texture_files.begin(), ac3d.m_texture_files.end());
 
     // fix up materials
     for (size_t i = num_kids; i < m_objects[0].kids.size(); i++)
@@ -5849,6 +7096,88 @@ bool AC3D::merge(const AC3D &ac3d)
     return true;
 }
 
+void AC3D::addCounts(const AC3D &ac3d)
+{
+    m_warnings += ac3d.m_warnings;
+    m_errors += ac3d.m_errors;
+
+    m_ambiguous_texture_count += ac3d.m_ambiguous_texture_count;
+    m_blank_line_count += ac3d.m_blank_line_count;
+    m_collinear_surface_vertices_count += ac3d.m_collinear_surface_vertices_count;
+    m_different_mat_count += ac3d.m_different_mat_count;
+    m_different_surf_count += ac3d.m_different_surf_count;
+    m_different_uv_count += ac3d.m_different_uv_count;
+    m_duplicate_materials_count += ac3d.m_duplicate_materials_count;
+    m_duplicate_surfaces_count += ac3d.m_duplicate_surfaces_count;
+    m_duplicate_surfaces_order_count += ac3d.m_duplicate_surfaces_order_count;
+    m_duplicate_surfaces_winding_count += ac3d.m_duplicate_surfaces_winding_count;
+    m_duplicate_surface_vertices_count += ac3d.m_duplicate_surface_vertices_count;
+    m_duplicate_texture_count += ac3d.m_duplicate_texture_count;
+    m_duplicate_triangles_count += ac3d.m_duplicate_triangles_count;
+    m_duplicate_vertices_count += ac3d.m_duplicate_vertices_count;
+    m_empty_object_count += ac3d.m_empty_object_count;
+    m_extra_object_count += ac3d.m_extra_object_count;
+    m_extra_uv_coordinates_count += ac3d.m_extra_uv_coordinates_count;
+    m_floating_point_count += ac3d.m_floating_point_count;
+    m_group_with_geometry_count += ac3d.m_group_with_geometry_count;
+    m_invalid_material_count += ac3d.m_invalid_material_count;
+    m_invalid_normal_length_count += ac3d.m_invalid_normal_length_count;
+    m_invalid_object_type_count += ac3d.m_invalid_object_type_count;
+    m_invalid_ref_count_count += ac3d.m_invalid_ref_count_count;
+    m_material_after_object_count += ac3d.m_material_after_object_count;
+    m_missing_kids_count += ac3d.m_missing_kids_count;
+    m_missing_mat_count += ac3d.m_missing_mat_count;
+    m_missing_normal_count += ac3d.m_missing_normal_count;
+    m_missing_surfaces_count += ac3d.m_missing_surfaces_count;
+    m_missing_texture_count += ac3d.m_missing_texture_count;
+    m_missing_uv_coordinates_count += ac3d.m_missing_uv_coordinates_count;
+    m_multiple_crease_count += ac3d.m_multiple_crease_count;
+    m_multiple_data_count += ac3d.m_multiple_data_count;
+    m_multiple_folded_count += ac3d.m_multiple_folded_count;
+    m_multiple_hidden_count += ac3d.m_multiple_hidden_count;
+    m_multiple_loc_count += ac3d.m_multiple_loc_count;
+    m_multiple_locked_count += ac3d.m_multiple_locked_count;
+    m_multiple_name_count += ac3d.m_multiple_name_count;
+    m_multiple_rot_count += ac3d.m_multiple_rot_count;
+    m_multiple_shader_count += ac3d.m_multiple_shader_count;
+    m_multiple_subdiv_count += ac3d.m_multiple_subdiv_count;
+    m_multiple_texoff_count += ac3d.m_multiple_texoff_count;
+    m_multiple_texrep_count += ac3d.m_multiple_texrep_count;
+    m_multiple_texture_count += ac3d.m_multiple_texture_count;
+    m_multiple_url_count += ac3d.m_multiple_url_count;
+    m_multiple_world_count += ac3d.m_multiple_world_count;
+    m_overlapping_2_sided_surface_count += ac3d.m_overlapping_2_sided_surface_count;
+    m_surface_2_sided_opaque_count += ac3d.m_surface_2_sided_opaque_count;
+    m_surface_not_convex_count += ac3d.m_surface_not_convex_count;
+    m_surface_not_coplanar_count += ac3d.m_surface_not_coplanar_count;
+    m_surface_no_texture_count += ac3d.m_surface_no_texture_count;
+    m_surface_self_intersecting_count += ac3d.m_surface_self_intersecting_count;
+    m_surface_strip_degenerate_count += ac3d.m_surface_strip_degenerate_count;
+    m_surface_strip_duplicate_triangles_count += ac3d.m_surface_strip_duplicate_triangles_count;
+    m_surface_strip_size_count += ac3d.m_surface_strip_size_count;
+    m_surface_zero_area_uv_count += ac3d.m_surface_zero_area_uv_count;
+    m_trailing_text_count += ac3d.m_trailing_text_count;
+    m_unsupported_version_count += ac3d.m_unsupported_version_count;
+    m_unused_material_count += ac3d.m_unused_material_count;
+    m_unused_vertex_count += ac3d.m_unused_vertex_count;
+    m_utf8_bom_count += ac3d.m_utf8_bom_count;
+    m_multiple_polygon_surface_count += ac3d.m_multiple_polygon_surface_count;
+    m_surface_strip_hole_count += ac3d.m_surface_strip_hole_count;
+    m_invalid_kids_count_count += ac3d.m_invalid_kids_count_count;
+    m_invalid_material_index_count += ac3d.m_invalid_material_index_count;
+    m_invalid_normal_count += ac3d.m_invalid_normal_count;
+    m_invalid_numsurf_count += ac3d.m_invalid_numsurf_count;
+    m_invalid_numvert_count += ac3d.m_invalid_numvert_count;
+    m_invalid_refs_count_count += ac3d.m_invalid_refs_count_count;
+    m_invalid_ref_vertex_index_count += ac3d.m_invalid_ref_vertex_index_count;
+    m_invalid_surface_type_count += ac3d.m_invalid_surface_type_count;
+    m_invalid_token_count += ac3d.m_invalid_token_count;
+    m_invalid_texture_coordinate_count += ac3d.m_invalid_texture_coordinate_count;
+    m_invalid_vertex_count += ac3d.m_invalid_vertex_count;
+    m_missing_vertex_count += ac3d.m_missing_vertex_count;
+    m_more_surf_than_specified_count += ac3d.m_more_surf_than_specified_count;
+}
+
 void AC3D::Object::incrementMaterialIndex(size_t num_materials)
 {
     if (type.type == "poly")
@@ -5971,6 +7300,8 @@ bool AC3D::Object::splitPolygons()
 
 void AC3D::flatten()
 {
+    const Profiler::Scope scope(m_profiler, "flatten", Profiler::Trace::yes);
+
     const Matrix matrix;
 
     transform(matrix);
@@ -5980,6 +7311,8 @@ void AC3D::flatten()
 
 bool AC3D::splitPolygons()
 {
+    const Profiler::Scope scope(m_profiler, "splitPolygons", Profiler::Trace::yes);
+
     bool changed = false;
 
     for (auto &object : m_objects)
@@ -5990,6 +7323,8 @@ bool AC3D::splitPolygons()
 
 void AC3D::removeObjects(const RemoveInfo &remove_info)
 {
+    const Profiler::Scope scope(m_profiler, "removeObjects", Profiler::Trace::yes);
+
     for (auto &object : m_objects)
         object.removeKids(remove_info);
 }
@@ -6093,15 +7428,18 @@ void AC3D::combineTexture(const Object &object, std::vector<Object> &objects, st
 
 void AC3D::combineTexture()
 {
+    const Profiler::Scope scope(m_profiler, "combineTexture", Profiler::Trace::yes);
+
     std::chrono::system_clock::time_point start;
 
     if (m_show_times)
     {
-        std::cout << "combineTexture starting" << std::endl;
+        *m_out << "combineTexture starting" << std::endl;
         start = std::chrono::system_clock::now();
     }
 
     flatten();
+    prefetchTransparentTextures();
 
     std::vector<Object> new_objects;
     std::vector<Object> new_transparent_objects;
@@ -6132,28 +7470,46 @@ void AC3D::combineTexture()
     if (m_show_times)
     {
         const std::chrono::system_clock::time_point end = std::chrono::system_clock::now();
-        std::cout << "combineTexture done: duration: " << getDuration(start, end) << std::endl;
+        *m_out << "combineTexture done: duration: " << getDuration(start, end) << std::endl;
     }
 }
 
 void AC3D::fixOverlapping2SidedSurface()
 {
+    const Profiler::Scope scope(m_profiler, "fixOverlapping2SidedSurface", Profiler::Trace::yes);
+
     std::vector<Poly> polys;
     const Matrix matrix;
 
-    for (auto &world : m_objects)
-        addPoly(polys, world, matrix);
+    {
+        const Profiler::Scope broad(m_profiler, "overlapBroadPhase", Profiler::Trace::yes);
+
+        for (auto &world : m_objects)
+            addPoly(polys, world, matrix);
+    }
 
     if (polys.empty())
         return;
 
-    std::set<Surface *> surfaces;
+    std::vector<std::set<Surface *>> poly_surfaces(polys.size() - 1);
 
-    for (size_t i = 0; i < (polys.size() - 1); ++i)
+    threadPool().parallelFor(0, polys.size() - 1, [this, &polys, &poly_surfaces](size_t i)
     {
+        Profiler::Scope narrow(m_profiler, "overlapNarrowPhase", Profiler::Trace::yes);
+
+        if (!polys[i].object->names.empty())
+            narrow.arg(polys[i].object->names.back().name);
+
+        Stats::Counts *counts = Stats::counts(m_stats);
+
         for (size_t j = i + 1; j < polys.size(); ++j)
-            fixOverlapping2SidedSurface(polys[i], polys[j], surfaces);
-    }
+            fixOverlapping2SidedSurface(polys[i], polys[j], poly_surfaces[i], counts);
+    });
+
+    std::set<Surface *> surfaces;
+
+    for (const auto &overlapping : poly_surfaces)
+        surfaces.insert(overlapping.begin(), overlapping.end());
 
     for (auto *surface : surfaces)
     {
@@ -6177,36 +7533,59 @@ void AC3D::fixOverlapping2SidedSurface()
     }
 }
 
-void AC3D::fixOverlapping2SidedSurface(const Poly &object1, const Poly &object2, std::set<Surface*> &surfaces)
+void AC3D::fixOverlapping2SidedSurface(const Poly &object1, const Poly &object2, std::set<Surface*> &surfaces, Stats::Counts *counts)
 {
-    for (auto &surface1 : object1.object->surfaces)
+    const size_t pairs = doubleSidedPairs(object1, object2);
+
+    if (pairs == 0)
+        return;
+
+    Stats::add(counts, Stats::overlap_triangle_pairs, pairs);
+
+    if (!object2.boxes.boundsOverlap(object1.boxes))
+    {
+        Stats::add(counts, Stats::overlap_bounding_box_rejects, pairs);
+        return;
+    }
+
+    size_t tested = 0;
+
+    // the triangles of object2 whose boxes overlap a triangle of object1
+    std::vector<size_t> candidates;
+
+    for (size_t i = 0; i < object1.triangles.size(); ++i)
     {
-        for (auto &surface2 : object2.object->surfaces)
+        const Poly::PolyTriangle &triangle1 = object1.triangles[i];
+
+        candidates.clear();
+        object2.boxes.overlapping(object1.boxes, i, candidates);
+
+        for (const size_t j : candidates)
         {
-            if (surface1.isDoubleSided() || surface2.isDoubleSided())
+            const Poly::PolyTriangle &triangle2 = object2.triangles[j];
+
+            if (!triangle1.surface->isDoubleSided() && !triangle2.surface->isDoubleSided())
+                continue;
+
+            tested++;
+
+            if (trianglesOverlap(*triangle1.triangle, *triangle2.triangle, counts, &triangle1.plane, &triangle2.plane))
             {
-                if (!surface1.transformedTriangles.empty() &&
-                    !surface2.transformedTriangles.empty())
-                {
-                    for (const auto &triangle1 : surface1.transformedTriangles)
-                    {
-                        for (const auto &triangle2 : surface2.transformedTriangles)
-                        {
-                            if (trianglesOverlap(triangle1, triangle2))
-                            {
-                                surfaces.insert(&surface1);
-                                surfaces.insert(&surface2);
-                            }
-                        }
-                    }
-                }
+                surfaces.insert(triangle1.surface);
+                surfaces.insert(triangle2.surface);
             }
         }
     }
+
+    Stats::add(counts, Stats::overlap_bounding_box_rejects, pairs - tested);
 }
 
 void AC3D::fixSurface2SidedOpaque()
 {
+    const Profiler::Scope scope(m_profiler, "fixSurface2SidedOpaque", Profiler::Trace::yes);
+
+    prefetchTransparentTextures();
+
     for (auto &object : m_objects)
         fixSurface2SidedOpaque(object);
 }
@@ -6237,21 +7616,340 @@ void AC3D::fixSurface2SidedOpaque(Object &object)
     }
 }
 
-bool AC3D::hasOpaqueTexture(const Object &object)
+const AC3D::TextureLookup &AC3D::lookupTexture(const std::string &texture_name)
+{
+    const std::map<std::string, TextureLookup>::const_iterator it = m_texture_lookups.find(texture_name);
+
+    if (it != m_texture_lookups.end())
+        return it->second;
+
+    TextureLookup &lookup = m_texture_lookups[texture_name];
+    const std::filesystem::path file_path(m_file);
+    std::filesystem::path texture_path(texture_name);
+    const bool absolute = texture_path.is_absolute() ||
+        (texture_name.size() >= 2 &&
+         std::isalpha(static_cast<unsigned char>(texture_name[0])) != 0 &&
+         texture_name[1] == ':');
+
+    lookup.path = texture_name;
+
+    // use parent path of file when available
+    // and texture path is not absolute
+    if (!file_path.parent_path().empty() && !absolute)
+    {
+        texture_path = file_path.parent_path().append(texture_name);
+
+        if (fileExists(texture_path))
+            lookup.path = texture_path.generic_string();
+    }
+
+    lookup.texture_path = texture_path.generic_string();
+
+    if (!fileExists(texture_path))
+    {
+        bool found = false;
+
+        if (!absolute) // don't search if absolute path
+        {
+            // look in alternate paths if available
+            for (const auto &path : m_texture_paths)
+            {
+                const std::filesystem::path new_path = std::filesystem::path(path).append(texture_name);
+                if (fileExists(new_path))
+                {
+                    found = true;
+                    lookup.path = new_path.generic_string();
+                    break;
+                }
+            }
+        }
+
+        lookup.missing = !found;
+    }
+    else if (!absolute && !m_texture_paths.empty()) // look for duplicate textures
+    {
+        for (const auto &path : m_texture_paths)
+        {
+            const std::filesystem::path other = std::filesystem::path(path).append(texture_name);
+            if (fileExists(other))
+            {
+                if (lookup.path.empty())
+                    lookup.path = other.generic_string();
+
+                lookup.others.emplace_back(other.generic_string(), matchTextures(texture_path, other));
+            }
+        }
+    }
+
+    return lookup;
+}
+
+bool AC3D::fileExists(const std::filesystem::path &path)
+{
+    const std::filesystem::path filename = path.filename();
+
+    if (filename.empty() || filename == "." || filename == "..")
+        return std::filesystem::exists(path);
+
+    std::filesystem::path directory = path.parent_path();
+
+    if (directory.empty())
+        directory = ".";
+
+    // list each directory once instead of checking every file separately
+    const auto [it, inserted] = m_directories.try_emplace(directory.generic_string());
+
+    if (inserted)
+    {
+        std::error_code ec;
+
+        for (std::filesystem::directory_iterator entry(directory, ec), end; !ec && entry != end; entry.increment(ec))
+        {
+            std::error_code exists_ec;
+
+            if (entry->exists(exists_ec))
+                it->second.insert(fileName(entry->path()));
+        }
+    }
+
+    return it->second.find(fileName(path)) != it->second.end();
+}
+
+std::string AC3D::fileName(const std::filesystem::path &path)
+{
+    std::string name = path.filename().generic_string();
+
+#ifdef _WIN32
+    // file names aren't case sensitive
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+#endif
+
+    return name;
+}
+
+bool AC3D::textureHash(const std::filesystem::path &path, std::uint64_t &hash)
+{
+    const std::string name = path.generic_string();
+    const std::map<std::string, std::uint64_t>::const_iterator it = m_texture_hashes.find(name);
+
+    if (it != m_texture_hashes.end())
+    {
+        hash = it->second;
+        return true;
+    }
+
+    if (m_texture_cache == nullptr || !m_texture_cache->findHash(name, hash))
+    {
+        if (!Hash64::file(name, hash))
+            return false;
+
+        if (m_texture_cache != nullptr)
+            m_texture_cache->insertHash(name, hash);
+    }
+
+    m_texture_hashes[name] = hash;
+
+    return true;
+}
+
+bool AC3D::sameContents(const std::filesystem::path &path1, const std::filesystem::path &path2)
+{
+    std::ifstream file1(path1, std::ifstream::binary);
+    std::ifstream file2(path2, std::ifstream::binary);
+    std::vector<char> buffer1(64 * 1024);
+    std::vector<char> buffer2(64 * 1024);
+
+    while (file1 && file2)
+    {
+        file1.read(buffer1.data(), static_cast<std::streamsize>(buffer1.size()));
+        file2.read(buffer2.data(), static_cast<std::streamsize>(buffer2.size()));
+
+        if (file1.gcount() != file2.gcount() ||
+            std::memcmp(buffer1.data(), buffer2.data(), static_cast<size_t>(file1.gcount())) != 0)
+        {
+            return false;
+        }
+    }
+
+    return !file1.bad() && !file2.bad() && file1.eof() && file2.eof();
+}
+
+AC3D::TextureMatch AC3D::matchTextures(const std::filesystem::path &texture_path, const std::filesystem::path &other)
+{
+    const std::pair<std::string, std::string> key(texture_path.generic_string(), other.generic_string());
+    const std::map<std::pair<std::string, std::string>, TextureMatch>::const_iterator it = m_texture_matches.find(key);
+
+    if (it != m_texture_matches.end())
+        return it->second;
+
+    TextureMatch match = TextureMatch::ambiguous;
+
+    if (std::filesystem::file_size(texture_path) == std::filesystem::file_size(other))
+    {
+        std::uint64_t hash1;
+        std::uint64_t hash2;
+
+        if (textureHash(texture_path, hash1) && textureHash(other, hash2))
+        {
+            // a matching hash is trusted unless asked to make sure
+            if (hash1 == hash2 && (!m_compare_textures || sameContents(texture_path, other)))
+                match = TextureMatch::duplicate;
+        }
+        else
+            match = TextureMatch::none;
+    }
+
+    m_texture_matches[key] = match;
+
+    return match;
+}
+
+bool AC3D::classifyTexture(const Texture &texture, std::ostream &out, std::ostream &err)
 {
+    TextureCache::Info info;
+
+    if (m_texture_cache != nullptr && m_texture_cache->find(texture.path, info))
+        return info.transparent;
+
+    bool transparent = false;
+
+    {
+        Profiler::Scope scope(m_profiler, "decodeTexture", Profiler::Trace::yes);
+
+        scope.arg(texture.path);
+        transparent = texture.isTransparent(out, err, &info);
+    }
+
+    // only textures that were decoded without problems are cached so the
+    // messages about the others are still shown every time
+    if (m_texture_cache != nullptr && info.channels != 0)
+        m_texture_cache->insert(texture.path, info);
+
+    return transparent;
+}
+
+void AC3D::storeTransparentTexture(const Texture &texture)
+{
+    std::ostringstream out;
+    std::ostringstream err;
+    const bool transparent = classifyTexture(texture, out, err);
+
+    const std::lock_guard<std::mutex> lock(m_transparent_textures_mutex);
+    TransparentTexture &transparent_texture = m_transparent_textures[texture.path];
+
+    transparent_texture.transparent = transparent;
+    transparent_texture.out = out.str();
+    transparent_texture.err = err.str();
+}
+
+// Starts decoding the texture of an object when the SURF line of a 2 sided
+// surface is read so it can be ready by the time checkSurface2SidedOpaque
+// needs it. Only textures that would be decoded anyway are started.
+void AC3D::prefetchTransparentTexture(const Object &object, const Surface &surface)
+{
+    if (!m_surface_2_sided_opaque || threadPool().threads() == 1)
+        return;
+
+    if (!(surface.isPolygon() || surface.isTriangleStrip()) || !surface.isDoubleSided())
+        return;
+
     if (object.textures.empty() || object.textures[0].name.empty())
-        return false;
+        return;
+
+    const std::map<std::string, Texture>::const_iterator file = m_texture_files.find(object.textures[0].path);
+
+    if (file == m_texture_files.end())
+        return;
+
+    const std::lock_guard<std::mutex> lock(m_transparent_textures_mutex);
+    const auto [it, inserted] = m_transparent_textures.try_emplace(file->first);
+
+    if (!inserted)
+        return;
+
+    threadPool().run(it->second.decoding, [this, &texture = file->second]
+    {
+        storeTransparentTexture(texture);
+    });
+}
+
+void AC3D::waitForTextures()
+{
+    std::vector<ThreadPool::TaskGroup *> groups;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_transparent_textures_mutex);
+
+        for (auto &[path, texture] : m_transparent_textures)
+            groups.push_back(&texture.decoding);
+    }
+
+    for (ThreadPool::TaskGroup *group : groups)
+        threadPool().wait(*group);
+}
+
+void AC3D::prefetchTransparentTextures()
+{
+    const Profiler::Scope scope(m_profiler, "prefetchTransparentTextures");
+
+    std::vector<const Texture *> textures;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_transparent_textures_mutex);
+
+        for (const auto &[path, texture] : m_texture_files)
+        {
+            if (m_transparent_textures.find(path) == m_transparent_textures.end())
+                textures.push_back(&texture);
+        }
+    }
+
+    threadPool().parallelFor(0, textures.size(), [this, &textures](size_t i)
+    {
+        storeTransparentTexture(*textures[i]);
+    });
+}
 
-    const std::map<std::string, bool>::iterator it = m_transparent_textures.find(object.textures[0].path);
+bool AC3D::isTransparentTexture(const Texture &texture)
+{
+    std::unique_lock<std::mutex> lock(m_transparent_textures_mutex);
+    const std::map<std::string, TransparentTexture>::iterator it = m_transparent_textures.find(texture.path);
 
     if (it != m_transparent_textures.end())
-        return !it->second;
+    {
+        // only waits for this texture and decodes it here if it's still queued
+        lock.unlock();
+        threadPool().wait(it->second.decoding);
+        lock.lock();
+
+        *m_out << it->second.out;
+        showMessages(it->second.err);
+        it->second.out.clear();
+        it->second.err.clear();
+
+        return it->second.transparent;
+    }
+
+    // not prefetched (a single thread or a merged file)
+    lock.unlock();
+
+    std::ostringstream err;
+    const bool transparent = classifyTexture(texture, *m_out, err);
+
+    showMessages(err.str());
 
-    const bool transparent = object.hasTransparentTexture();
+    lock.lock();
+    m_transparent_textures[texture.path].transparent = transparent;
 
-    m_transparent_textures[object.textures[0].path] = transparent;
+    return transparent;
+}
+
+bool AC3D::hasOpaqueTexture(const Object &object)
+{
+    if (object.textures.empty() || object.textures[0].name.empty())
+        return false;
 
-    return !transparent;
+    return !isTransparentTexture(object.textures[0]);
 }
 
 bool AC3D::hasTransparentTexture(const Object &object)
@@ -6259,50 +7957,64 @@ bool AC3D::hasTransparentTexture(const Object &object)
     if (object.textures.empty() || object.textures[0].name.empty())
         return false;
 
-    const std::map<std::string, bool>::iterator it = m_transparent_textures.find(object.textures[0].path);
-
-    if (it != m_transparent_textures.end())
-        return it->second;
+    return isTransparentTexture(object.textures[0]);
+}
 
-    const bool transparent = object.hasTransparentTexture();
+namespace
+{
 
-    m_transparent_textures[object.textures[0].path] = transparent;
+// libpng writes its errors and warnings to stderr by default, which puts them
+// in the middle of JSON Lines or SARIF output and, when the texture is
+// decoded on another thread, anywhere in the output. Errors are saved so
+// they can be reported with the texture and warnings, like the one about a
+// known incorrect sRGB profile, don't change the result so are dropped.
+void pngError(png_structp png_ptr, png_const_charp message)
+{
+    *static_cast<std::string *>(png_get_error_ptr(png_ptr)) = message;
+    png_longjmp(png_ptr, 1);
+}
 
-    return transparent;
+void pngWarning(png_structp, png_const_charp)
+{
 }
 
-bool AC3D::Object::hasTransparentTexture() const
+} // namespace
+
+bool AC3D::Texture::isTransparent(std::ostream &out, std::ostream &err, TextureCache::Info *info) const
 {
-    if (textures.empty() || textures[0].name.empty())
+    if (name.empty())
         return false;
 
     // RAII handle file descriptor to prevent leakages
-    std::unique_ptr<FILE, decltype(&fclose)> fp(fopen(textures[0].path.c_str(), "rb"), &fclose);
+    std::unique_ptr<FILE, decltype(&fclose)> fp(fopen(path.c_str(), "rb"), &fclose);
     if (!fp) {
-        std::cout << "guessing texture type: " << textures[0].path.c_str() << std::endl;
+        out << "guessing texture type: " << path.c_str() << std::endl;
 
         // Fallback name parsing guessing heuristics
-        return (textures[0].name.find("_n.") != std::string::npos ||
-            textures[0].name.find("tree") != std::string::npos ||
-            textures[0].name.find("trans-") != std::string::npos ||
-            textures[0].name.find("arbor") != std::string::npos);
+        return (name.find("_n.") != std::string::npos ||
+            name.find("tree") != std::string::npos ||
+            name.find("trans-") != std::string::npos ||
+            name.find("arbor") != std::string::npos);
     }
 
     const size_t number = 8;
     unsigned char header[number];
 
     if (fread(header, 1, number, fp.get()) != number) {
-        std::cerr << "error reading png header: " << textures[0].path.c_str() << std::endl;
+        err << "error reading png header: " << path.c_str() << std::endl;
         return false;
     }
 
     const bool is_png = !png_sig_cmp(header, 0, number);
     if (!is_png) {
-        std::cerr << "invalid png header " << textures[0].path.c_str() << std::endl;
+        err << "invalid png header " << path.c_str() << std::endl;
         return false;
     }
 
-    png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    // set by pngError before it jumps back to the setjmp below
+    std::string png_error;
+
+    png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, &png_error, pngError, pngWarning);
     if (!png_ptr) {
         return false;
     }
@@ -6326,11 +8038,11 @@ bool AC3D::Object::hasTransparentTexture() const
         return false;
     }
 
-    // Modern memory guards utilizing custom unique_ptr wrappers
-    std::unique_ptr<png_byte, decltype(&free)> image_data(nullptr, &free);
-    std::unique_ptr<png_bytep[], decltype(&free)> row_pointers(nullptr, &free);
+    // declared before setjmp so a longjmp can't skip its destructor
+    std::vector<png_byte> row;
 
     if (setjmp(png_jmpbuf(png_ptr))) {
+        err << "error reading png: " << path.c_str() << ": " << png_error << std::endl;
         return false;
     }
 
@@ -6338,49 +8050,63 @@ bool AC3D::Object::hasTransparentTexture() const
     png_set_sig_bytes(png_ptr, number);
     png_read_info(png_ptr, png_bridge.info);
 
-    png_uint_32 width, height;
-    int bit_depth, color_type, interlace_type, compression_type, filter_method;
-    png_get_IHDR(png_ptr, png_bridge.info, &width, &height, &bit_depth, &color_type, &interlace_type, &compression_type, &filter_method);
-    const int channels = png_get_channels(png_ptr, png_bridge.info);
-
-    // Filter processing down strictly to standard 32-bit RGBA maps
-    if (color_type != PNG_COLOR_TYPE_RGB_ALPHA || bit_depth != 8 || channels != 4) {
-        return false;
-    }
-
-    const size_t rowbytes = png_get_rowbytes(png_ptr, png_bridge.info);
+    // only reported when the image could be checked without errors
+    TextureCache::Info decoded;
+    decoded.width = png_get_image_width(png_ptr, png_bridge.info);
+    decoded.height = png_get_image_height(png_ptr, png_bridge.info);
+    decoded.channels = png_get_channels(png_ptr, png_bridge.info);
+    decoded.bit_depth = png_get_bit_depth(png_ptr, png_bridge.info);
 
-    image_data.reset(static_cast<png_byte *>(malloc(rowbytes * height)));
-    if (!image_data) {
-        return false;
-    }
-
-    row_pointers.reset(static_cast<png_bytep *>(malloc(sizeof(png_bytep) * height)));
-    if (!row_pointers) {
-        return false;
-    }
-
-    for (png_uint_32 i = 0; i < height; ++i)
-        row_pointers[i] = image_data.get() + i * rowbytes;
-
-    png_set_rows(png_ptr, png_bridge.info, row_pointers.get());
-    png_read_image(png_ptr, row_pointers.get());
-    png_read_end(png_ptr, nullptr);
-
-    bool has_alpha = false;
-    const png_byte *raw_buffer = image_data.get();
+    auto result = [info, &decoded](bool transparent) {
+        if (info) {
+            decoded.transparent = transparent;
+            *info = decoded;
+        }
+        return transparent;
+    };
 
-    // Scan memory explicitly pointing to the 4th element (alpha) block
-    for (png_uint_32 i = 0; i < (width * height); i++) {
-        const png_byte *pixel = raw_buffer + (i * 4);
-        const png_byte alpha = pixel[3]; // Correct channel selection offset via array index
-        if (alpha != 255) {
-            has_alpha = true;
-            break; // Immediately exit parsing tracking once matching a transparent fragment
+    const int color_type = png_get_color_type(png_ptr, png_bridge.info);
+    const bool has_trns = png_get_valid(png_ptr, png_bridge.info, PNG_INFO_tRNS) != 0;
+
+    // no alpha channel and no transparent color so no need to decode anything
+    if ((color_type & PNG_COLOR_MASK_ALPHA) == 0 && !has_trns) {
+        return result(false);
+    }
+
+    // Expand palettes to RGB, tRNS to an alpha channel and low bit depth
+    // gray to 8 bits. 16 bit images are kept as is so an alpha of 0xfffe
+    // isn't rounded up to opaque.
+    png_set_expand(png_ptr);
+    const int passes = png_set_interlace_handling(png_ptr);
+    png_read_update_info(png_ptr, png_bridge.info);
+
+    const png_uint_32 width = decoded.width;
+    const png_uint_32 height = decoded.height;
+    const size_t channels = png_get_channels(png_ptr, png_bridge.info);
+    const size_t bytes = png_get_bit_depth(png_ptr, png_bridge.info) == 16 ? 2 : 1;
+    const size_t pixel_bytes = channels * bytes;
+
+    // only one row is decoded at a time and the first pixel that isn't
+    // opaque stops the scan
+    row.resize(png_get_rowbytes(png_ptr, png_bridge.info));
+
+    for (int pass = 0; pass < passes; ++pass) {
+        for (png_uint_32 y = 0; y < height; ++y) {
+            // pixels not in this interlace pass are left as opaque
+            std::fill(row.begin(), row.end(), 0xff);
+            png_read_row(png_ptr, row.data(), nullptr);
+
+            for (png_uint_32 x = 0; x < width; ++x) {
+                // alpha is the last channel
+                const png_byte *alpha = row.data() + x * pixel_bytes + pixel_bytes - bytes;
+                if (alpha[0] != 0xff || (bytes == 2 && alpha[1] != 0xff)) {
+                    return result(true);
+                }
+            }
         }
     }
 
-    return has_alpha;
+    return result(false);
 }
 
 std::string AC3D::getTime(const std::chrono::time_point<std::chrono::system_clock> &time)
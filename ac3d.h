@@ -25,16 +25,30 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
 #include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <numbers>
 #include <set>
 #include <regex>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "boundingboxes.h"
+#include "diagnostic.h"
+#include "diagnosticbuf.h"
+#include "profiler.h"
+#include "stats.h"
+#include "texturecache.h"
+#include "threadpool.h"
+#include "writer.h"
+
 class AC3D
 {
 #define CHECK(func, var, state)                        \
@@ -135,6 +149,9 @@ private:                                               \
     void showLine(std::istream &in, const std::streampos &pos, int offset = 0) const;
 
 public:
+    AC3D() = default;
+    ~AC3D();
+
     enum class DumpType { group, poly, surf};
 
     struct RemoveInfo
@@ -150,6 +167,12 @@ public:
     bool read(const std::string &file);
     bool write(const std::string &file, int version = 0);
     void dump(DumpType dump_type) const;
+    // Shows the bytes used by the vertices, refs, texture coordinates,
+    // triangles, materials, strings and line numbers of each top level
+    // object and the peak memory of the process so far.
+    void memoryReport(const std::string &phase) const;
+    // bytes, 0 when it isn't known
+    static size_t peakMemory();
     size_t warnings() const
     {
         return m_warnings;
@@ -206,6 +229,64 @@ public:
     {
         return m_threads;
     }
+    // Use a thread pool shared with other AC3D instances. Without one a
+    // private pool with threads() threads is created when first needed.
+    void threadPool(ThreadPool *pool)
+    {
+        m_thread_pool = pool;
+    }
+    ThreadPool &threadPool();
+    // Compare the contents of textures with the same hash before calling
+    // them duplicates.
+    void compareTextures(bool value)
+    {
+        m_compare_textures = value;
+    }
+    // Copy objects that weren't changed from the input file when writing
+    // instead of formatting them again.
+    void copyUnchanged(bool value)
+    {
+        m_copy_unchanged = value;
+    }
+    // zlib compression level (0 to 9, -1 for the default) used when
+    // writing .ac.gz and .acc.gz files.
+    void compressionLevel(int level)
+    {
+        m_compression_level = level;
+    }
+    // Use a cache of textures decoded by previous runs.
+    void textureCache(TextureCache *cache)
+    {
+        m_texture_cache = cache;
+    }
+    // Times reading, each check, each fix and writing. Nothing is timed
+    // without one.
+    void profiler(Profiler *profiler)
+    {
+        m_profiler = profiler;
+    }
+    // Counts the work done by the expensive checks. Nothing is counted
+    // without one.
+    void stats(Stats *stats)
+    {
+        m_stats = stats;
+    }
+    // Where informational messages and diagnostics are written. Defaults
+    // to std::cout and std::cerr.
+    void outputStream(std::ostream &out)
+    {
+        m_out = &out;
+    }
+    void errorStream(std::ostream &err)
+    {
+        m_err = &err;
+    }
+    // The buffer behind the error stream, told when an error is written
+    // so it can be flushed after errors.
+    void diagnosticBuf(DiagnosticBuf *buf)
+    {
+        m_diagnostic_buf = buf;
+    }
     void quiet(bool value)
     {
         m_quiet = value;
@@ -218,6 +299,33 @@ public:
     {
         m_summary = value;
     }
+    // Show warnings and errors as text or in a machine readable format.
+    void diagnosticFormat(DiagnosticFormat format)
+    {
+        m_diagnostic_format = format;
+    }
+    DiagnosticFormat diagnosticFormat() const
+    {
+        return m_diagnostic_format;
+    }
+    // Include the source line in machine readable diagnostics.
+    void sourceExcerpts(bool value)
+    {
+        m_source_excerpts = value;
+    }
+    // Write the last machine readable diagnostic which is kept until it's
+    // known that no more notes will be added to it.
+    void finishDiagnostics();
+    // the -W names of all the checks
+    static std::vector<std::string> checkNames();
+    // Show at most max warnings and errors. The rest are only counted.
+    void maxDiagnostics(size_t max)
+    {
+        m_max_diagnostics = max;
+    }
+    // Show at most max warnings or errors from the check with the -W name.
+    // Returns false for an unknown name.
+    bool maxDiagnostics(const std::string &name, size_t max);
     bool summary() const
     {
         return m_summary;
@@ -231,6 +339,7 @@ public:
     bool splitMultipleSURF();
     bool splitMultipleMat();
     bool merge(const AC3D& ac3d);
+    void addCounts(const AC3D &ac3d);
     void flatten();
     bool splitPolygons();
     void removeObjects(const RemoveInfo &remove_info);
@@ -521,6 +630,8 @@ private:
         quoted_string name;
         std::string type;
         std::string path;
+
+        bool isTransparent(std::ostream &out, std::ostream &err, TextureCache::Info *info = nullptr) const;
     };
 
     struct TexRep : public LineInfo
@@ -877,7 +988,7 @@ private:
         {
             return refs.size() == 3;
         }
-        void dump(size_t count, size_t level) const;
+        void dump(std::ostream &out, size_t count, size_t level) const;
     };
 
     struct Location : public LineInfo
@@ -928,6 +1039,16 @@ private:
         int number_offset = 0;
     };
 
+    // Where an object was read from. Only set when copying unchanged
+    // objects and the object would be written the same way it was read.
+    struct Source
+    {
+        size_t         file = 0;
+        std::streampos begin;
+        std::streampos end; // the kids line
+        std::uint64_t  fingerprint = 0;
+    };
+
     struct Object : public LineInfo
     {
         Type type;
@@ -951,6 +1072,7 @@ private:
         std::vector<Surface> surfaces;
         std::vector<Object> kids;
         Matrix matrix;
+        Source source;
 
         bool empty() const
         {
@@ -1058,9 +1180,8 @@ private:
             return none;
         }
 
-        bool hasTransparentTexture() const;
         bool sameSurface(size_t index1, size_t index2, Difference difference) const;
-        void dump(DumpType dump_type, size_t count, size_t level) const;
+        void dump(std::ostream &out, DumpType dump_type, size_t count, size_t level) const;
         void incrementMaterialIndex(size_t num_materials);
         void transform(const Matrix &currentMatrix);
         void removeKids(const RemoveInfo &remove_info);
@@ -1069,20 +1190,48 @@ private:
         bool sameTextures(const Object &object) const;
     };
 
-    class NullBuffer : public std::streambuf
+    // What a warning, error or note is written to. Nothing is formatted
+    // when it isn't shown, so a check that is only counted costs little
+    // more than incrementing its count.
+    class DiagnosticStream
     {
-    protected:
-        int overflow(int c) override { return c; }  // discard, return success
-    };
-
-    class NullStream : public std::ostream
-    {
-        NullBuffer buf;
     public:
-        NullStream() : std::ostream(&buf) {}
-    };
+        explicit DiagnosticStream(std::ostream *out = nullptr) : m_out(out) {}
 
-    NullStream      m_null_stream;
+        template <typename T>
+        const DiagnosticStream &operator << (const T &value) const
+        {
+            if (m_out != nullptr)
+                *m_out << value;
+            return *this;
+        }
+
+        // std::endl and std::flush
+        const DiagnosticStream &operator << (std::ostream &(*manipulator)(std::ostream &)) const
+        {
+            if (m_out != nullptr)
+                *m_out << manipulator;
+            return *this;
+        }
+
+        // std::hex and std::dec
+        const DiagnosticStream &operator << (std::ios_base &(*manipulator)(std::ios_base &)) const
+        {
+            if (m_out != nullptr)
+                *m_out << manipulator;
+            return *this;
+        }
+
+        // false when it isn't shown, so arguments that are costly to make
+        // can be skipped
+        explicit operator bool() const
+        {
+            return m_out != nullptr;
+        }
+
+    private:
+        std::ostream *m_out;
+    };
 
     std::string     m_file;
     std::string     m_line;
@@ -1099,51 +1248,163 @@ private:
     bool            m_summary = false;
     bool            m_show_times = false;
     unsigned int    m_threads = 1;
+    ThreadPool      *m_thread_pool = nullptr;
+    std::unique_ptr<ThreadPool> m_own_thread_pool;
+    TextureCache    *m_texture_cache = nullptr;
+    Profiler        *m_profiler = nullptr;
+    Stats           *m_stats = nullptr;
+    bool            m_compare_textures = false;
+    int             m_compression_level = -1;
+    DiagnosticFormat m_diagnostic_format = DiagnosticFormat::text;
+    bool            m_source_excerpts = false;
+    // the machine readable diagnostic being built, showLine() adds to it
+    mutable Diagnostic m_diagnostic;
+    mutable std::ostringstream m_diagnostic_message;
+    bool            m_has_diagnostic = false;
+    size_t          m_max_diagnostics = std::numeric_limits<size_t>::max();
+    std::vector<std::pair<size_t AC3D::*, size_t>> m_max_check_diagnostics;
+    size_t          m_diagnostics_shown = 0;
+    // the last warning or error isn't shown so its source lines and notes
+    // aren't either
+    mutable bool    m_suppressed = false;
+    bool            m_copy_unchanged = false;
+    size_t          m_source_file = 0;
+    std::uintmax_t  m_source_size = 0;
+    std::string     m_source;
+    // lines that writing the object they are in again would change or drop,
+    // like blank lines and trailing text, whether or not they were reported
+    size_t          m_rewritten_lines = 0;
+    std::ostream    *m_out = &std::cout;
+    std::ostream    *m_err = &std::cerr;
+    DiagnosticBuf   *m_diagnostic_buf = nullptr;
 
     Header m_header;
     std::vector<Material> m_materials;
     std::vector<Object> m_objects;
     std::vector<std::string> m_texture_paths;
     bool m_has_world = false;
-    std::map<std::string, bool> m_transparent_textures;
+    // what was found for each texture name so it's only searched for once
+    enum class TextureMatch { none, duplicate, ambiguous };
+    struct TextureLookup
+    {
+        std::string path;
+        std::string texture_path;
+        bool missing = false;
+        std::vector<std::pair<std::string, TextureMatch>> others; // same name in -T paths
+    };
+    std::map<std::string, TextureLookup> m_texture_lookups;
+    std::map<std::string, std::set<std::string>> m_directories;
+    std::map<std::pair<std::string, std::string>, TextureMatch> m_texture_matches;
+    std::map<std::string, std::uint64_t> m_texture_hashes; // content hash of each texture file by path
+
+    std::map<std::string, Texture> m_texture_files; // first texture of each object by path
+
+    // Messages from checking a texture on another thread are saved and
+    // shown the first time it's used so they come out where they always did.
+    struct TransparentTexture
+    {
+        bool transparent = false;
+        std::string out;
+        std::string err;
+        ThreadPool::TaskGroup decoding; // set while decoded on the pool when reading
+    };
+
+    std::map<std::string, TransparentTexture> m_transparent_textures;
+    std::mutex m_transparent_textures_mutex;
     bool m_rename_combine_texture = false;
 
+    // A triangle's plane in float and how far its normal components and
+    // distance can be from the ones Plane computes in double. It lets
+    // trianglesOverlap() reject most pairs that aren't coplanar without
+    // building the planes.
+    struct FloatPlane
+    {
+        float x = 0;
+        float y = 0;
+        float z = 0;
+        float distance = 0;
+        float error = std::numeric_limits<float>::infinity(); // not known
+        float distance_error = std::numeric_limits<float>::infinity();
+    };
+
     struct Poly
     {
         Object *object = nullptr;
         Matrix matrix;
+
+        // the transformed triangles of all the surfaces in order and their boxes
+        struct PolyTriangle
+        {
+            Surface        *surface = nullptr;
+            const Triangle *triangle = nullptr;
+            FloatPlane      plane;
+        };
+        std::vector<PolyTriangle> triangles;
+        BoundingBoxes boxes;
+        size_t single_sided = 0; // triangles of 1 sided surfaces
+    };
+
+    struct Overlap
+    {
+        const Poly *object1 = nullptr;
+        const Poly *object2 = nullptr;
+        const Surface *surface1 = nullptr;
+        const Surface *surface2 = nullptr;
+        const Triangle *triangle1 = nullptr;
+        const Triangle *triangle2 = nullptr;
     };
 
     bool readHeader(std::istream &in);
-    void writeHeader(std::ostream &out, const Header &header) const;
+    void writeHeader(Writer &out, const Header &header) const;
     bool readTypeAndColor(std::istringstream &in, Color &color, const std::string_view &expected, const std::string_view &next, const std::string_view & last);
     bool readColor(std::istringstream &in, Color &color, const std::string_view &expected, const std::string_view &next);
     bool readTypeAndValue(std::istringstream &in, double &value, const std::string_view &expected, const std::string_view &next, double min, double max, bool is_float);
     bool readValue(std::istringstream &in, double &value, const std::string_view &expected, double min, double max, bool is_float);
     bool readData(std::istringstream &iss, std::istream &in, std::string &data);
-    void writeData(std::ostream &out, const std::string &data) const;
+    void writeData(Writer &out, const std::string &data) const;
     bool readMaterial(std::istringstream &in, Material &material);
     bool readMaterial(std::istringstream &first, std::istream &in, Material &material);
-    void writeMaterial(std::ostream &out, const Material &material) const;
+    void writeMaterial(Writer &out, const Material &material) const;
     bool readSurface(std::istream &in, Surface &surface, Object &object, bool get_line);
-    void writeSurface(std::ostream &out, const Surface &surface) const;
-    void writeSurfaces(std::ostream &out, const Object &object) const;
-    void writeVertices(std::ostream &out, const Object &object) const;
+    void writeSurface(Writer &out, const Surface &surface) const;
+    void writeSurfaces(Writer &out, const Object &object) const;
+    void writeVertices(Writer &out, const Object &object) const;
     bool readRef(std::istringstream &in, Ref &ref);
-    void writeRef(std::ostream &out, const Ref &ref) const;
+    void writeRef(Writer &out, const Ref &ref) const;
     bool readObject(std::istringstream &iss, std::istream &in, Object &object);
-    void writeObject(std::ostream &out, const Object &object) const;
+    void writeObjectData(Writer &out, const Object &object) const;
+    void writeObject(Writer &out, const Object &object) const;
+    void writeKids(Writer &out, const Object &object);
+    static bool canCopy(const Object &object);
+    static std::uint64_t fingerprint(const Object &object);
+    bool readSource();
     bool getLine(std::istream &in);
     bool ungetLine(std::istream &in);
-    std::ostream &warningWithCount(size_t &count, size_t line_number = 0);
-    std::ostream &error(size_t line_number = 0);
-    std::ostream &errorWithCount(size_t &count, size_t line_number = 0);
-    std::ostream &note(size_t line_number = 0);
+    DiagnosticStream warningWithCount(size_t &count, size_t line_number = 0);
+    DiagnosticStream error(size_t line_number = 0);
+    DiagnosticStream errorWithCount(size_t &count, size_t line_number = 0);
+    DiagnosticStream note(size_t line_number = 0);
+    std::ostream &message();
+    void showMessages(const std::string &text);
+    std::ostream &beginDiagnostic(const char *severity, const size_t *count, size_t line_number);
+    void takeDiagnosticMessage() const;
+    void showColumn(size_t column, std::string_view source) const;
+    const char *checkName(const size_t *count) const;
+    bool showDiagnostic(const size_t *count);
+    bool limitReached(const size_t &count) const;
+    bool totalsShown() const;
+    struct CheckName
+    {
+        const char   *name;
+        size_t AC3D::*count;
+    };
+    static const std::vector<CheckName> &checkTable();
     void checkTrailing(std::istringstream &iss);
     void checkUnusedMaterial(std::istream &in);
     void checkMissingMat(std::istream &in);
     void checkOverlapping2SidedSurface(std::istream &in);
-    void checkOverlapping2SidedSurface(std::istream &in, const Poly &object1, const Poly &object2);
+    static void findOverlapping2SidedSurface(const Poly &object1, const Poly &object2, std::vector<Overlap> &overlaps, Stats::Counts *counts);
+    void checkOverlapping2SidedSurface(std::istream &in, const Overlap &overlap);
     void checkDuplicateMaterials(std::istream &in);
     void checkUnusedVertex(std::istream &in, const Object &object);
     void checkDuplicateVertices(std::istream &in, const Object &object);
@@ -1168,7 +1429,6 @@ private:
     static Point3 surfaceRefNormal(const Surface &surface, size_t refIndex);
     void checkGroupWithGeometry(std::istream &in, const Object &object);
     static bool cleanObjects(std::vector<Object> &objects);
-    static bool cleanVertices(std::vector<Object> &objects);
     static bool cleanVertices(Object &object);
     static bool cleanSurfaces(std::vector<Object> &objects);
     static bool cleanSurfaces(Object &object);
@@ -1185,13 +1445,51 @@ private:
     void transform(const Matrix &matrix);
     void combineTexture(const Object &object, std::vector<Object> &objects, std::vector<Object> &transparent_objects);
     static void addPoly(std::vector<Poly> &polys, Object &object, const Matrix &matrix);
-    static void fixOverlapping2SidedSurface(const Poly &object1, const Poly &object2, std::set<Surface *> &surfaces);
+    static void fixOverlapping2SidedSurface(const Poly &object1, const Poly &object2, std::set<Surface *> &surfaces, Stats::Counts *counts);
+    void storeTransparentTexture(const Texture &texture);
+    void prefetchTransparentTexture(const Object &object, const Surface &surface);
+    void waitForTextures();
+    void prefetchTransparentTextures();
+    const TextureLookup &lookupTexture(const std::string &texture_name);
+    bool fileExists(const std::filesystem::path &path);
+    static std::string fileName(const std::filesystem::path &path);
+    bool textureHash(const std::filesystem::path &path, std::uint64_t &hash);
+    static bool sameContents(const std::filesystem::path &path1, const std::filesystem::path &path2);
+    TextureMatch matchTextures(const std::filesystem::path &texture_path, const std::filesystem::path &other);
+    bool classifyTexture(const Texture &texture, std::ostream &out, std::ostream &err);
+    bool isTransparentTexture(const Texture &texture);
     bool hasOpaqueTexture(const Object &object);
     bool hasTransparentTexture(const Object &object);
     void fixSurface2SidedOpaque(Object &object);
+    // the bytes used by a part of the model, see memoryReport()
+    struct Memory
+    {
+        size_t vertices = 0;
+        size_t refs = 0;
+        size_t coordinates = 0;
+        size_t triangle_strips = 0;
+        size_t transformed_triangles = 0;
+        size_t materials = 0;
+        size_t strings = 0;
+        size_t line_info = 0;
+        size_t other = 0;
+
+        size_t total() const
+        {
+            return vertices + refs + coordinates + triangle_strips + transformed_triangles +
+                   materials + strings + line_info + other;
+        }
+        Memory &operator += (const Memory &memory);
+    };
+    static void addMemory(const Object &object, Memory &memory);
     static void getObjects(std::vector<Object *> &polys, Object *object);
+    static void getAllObjects(std::vector<Object *> &objects, std::vector<Object> &kids);
 
     friend std::ostream & operator << (std::ostream &out, const Vertex &v);
+
+    // bench/geometry_bench.cpp times the tests below one at a time
+    friend class GeometryBench;
+
     static bool collinear(const Point3 &p1, const Point3 &p2, const Point3 &p3);
     static bool ccw(const AC3D::Point2 &p1, const AC3D::Point2 &p2, const AC3D::Point2 &p3);
     static double closest(const Point3 &p0, const Point3 &p1, const Point3 &p2, const Point3 &p3);
@@ -1200,8 +1498,13 @@ private:
     static bool degenerate(const Point3 &p0, const Point3 &p1, const Point3 &p2);
     static bool degenerate(const std::array<Point3, 3> &vertices);
     static bool coplanar(const Triangle &triangle1, const Triangle &triangle2);
+    static void addBoundingBox(BoundingBoxes &boxes, const Triangle &triangle);
+    static size_t doubleSidedPairs(const Poly &object1, const Poly &object2);
     static bool boundingBoxesOverlap(const Triangle &triangle1, const Triangle &triangle2);
-    static bool trianglesOverlap(const Triangle &triangle1, const Triangle &triangle2);
+    static FloatPlane floatPlane(const Triangle &triangle);
+    static bool notCoplanar(const FloatPlane &plane1, const FloatPlane &plane2);
+    static bool trianglesOverlap(const Triangle &triangle1, const Triangle &triangle2, Stats::Counts *counts = nullptr,
+                                 const FloatPlane *plane1 = nullptr, const FloatPlane *plane2 = nullptr);
     static size_t getSharedVertexCount(const Triangle &triangle1, const Triangle &triangle2);
     static bool pointInCoplanarTriangle(const Point3 &point, const Triangle &triangle);
     static PlaneType getPlaneType(const Point3 &normal);
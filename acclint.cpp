@@ -19,6 +19,8 @@
 //---------------------------------------------------------------------------
 
 #include <cstdlib>
+#include <mutex>
+#include <optional>
 
 #ifdef _WIN32
 #pragma warning( disable : 4996)
@@ -29,12 +31,14 @@
 
 #include "ac3d.h"
 #include "config.h"
+#include "diagnosticbuf.h"
 
 namespace {
 
 void usage()
 {
     std::cerr << "Usage: acclint [options] [-j <#>] [-T texturepath] <inputfile> [--merge <inputfile>] [-o <outputfile>] [-v <11|12>]" << std::endl;
+    std::cerr << "       acclint [options] [-j <#>] [-T texturepath] <inputfile> <inputfile>..." << std::endl;
     std::cerr << "Options:" << std::endl;
 
     // warnings
@@ -140,11 +144,25 @@ void usage()
     std::cerr << "  --combineTexture                       Combine objects by texture." << std::endl;
     std::cerr << "  --fixOverlapping2SidedSurface          Fix overlapping 2 sided surfaces." << std::endl;
     std::cerr << "  --fixSurface2SidedOpaque               Convert opaque 2 sided surfaces to single sided." << std::endl;
-    std::cerr << "  --showTimes                            Show execution times of some operations." << std::endl;
+    std::cerr << "  --showTimes                            Show execution times of reading, each check, each fix and writing." << std::endl;
+    std::cerr << "  --trace filename                       Write a Chrome trace of reading, checking, fixing and writing to filename." << std::endl;
+    std::cerr << "  --stats                                Show how much work the overlapping, self intersecting and duplicate checks did." << std::endl;
+    std::cerr << "  --memory-report                        Show the memory used by each part of the model after reading and each fix." << std::endl;
+    std::cerr << "  --textureCache filename                Remember decoded textures in filename between runs." << std::endl;
+    std::cerr << "  --compareTextures                      Compare the contents of textures with the same hash." << std::endl;
+    std::cerr << "  --compressionLevel 0-9                 Compression level of .ac.gz and .acc.gz output files." << std::endl;
+    std::cerr << "  --copyUnchanged                        Copy objects that weren't changed from the input file." << std::endl;
+    std::cerr << "  --diagnostics filename                 Write warnings and errors to filename instead of stderr." << std::endl;
+    std::cerr << "  --diagnosticsFd fd                     Write warnings and errors to file descriptor fd instead of stderr." << std::endl;
+    std::cerr << "  --flushDiagnostics lines|error|exit    Write warnings and errors every lines lines, after an error or at exit (default exit, 1 to a terminal)." << std::endl;
+    std::cerr << "  --format text|jsonl|sarif              Write warnings and errors as text, JSON Lines or SARIF." << std::endl;
+    std::cerr << "  --sourceExcerpts                       Include the source line in JSON Lines and SARIF output." << std::endl;
+    std::cerr << "  --max-diagnostics N                    Show at most N warnings and errors for each file." << std::endl;
+    std::cerr << "  --max-<warning> N                      Show at most N warnings or errors from -W<warning> for each file." << std::endl;
     std::cerr << "  --quiet                                Don't show warning messages." << std::endl;
     std::cerr << "  --summary                              Show summary of warnings." << std::endl;
 
-    std::cerr << "  -j #                                   Set number of threads to use." << std::endl;
+    std::cerr << "  -j #                                   Set number of threads to use (also used to check multiple input files at once)." << std::endl;
     std::cerr << "  -l                                     Print the name of the input file." << std::endl;
     std::cerr << std::endl;
     std::cerr << "By default all warnings (except blank-line, duplicate-triangles, surface-2-sided-opaque and surface-strip-*) " << std::endl;
@@ -158,6 +176,7 @@ void usage()
     std::cerr << "Examples:" << std::endl;
     std::cerr << "  acclint -Wno-trailing-text file.acc             Don't show trailing text warnings." << std::endl;
     std::cerr << "  acclint -Wno-warnings -Wunused-vertex file.acc  Only show unused vertex warnings." << std::endl;
+    std::cerr << "  acclint -j 8 --summary *.ac *.acc               Check all files using 8 threads and show a combined summary." << std::endl;
     std::cerr << "  acclint -Wno-warnings -j 8 -T ../../../data/textures original.ac --combineTexture -o new.ac" << std::endl;
 }
 
@@ -167,6 +186,216 @@ void showCount(size_t count, const char *text)
         std::cout << text << count << std::endl;
 }
 
+void showWarnings(const AC3D &ac3d)
+{
+    if (ac3d.warnings() > 0)
+    {
+        if (ac3d.diagnosticFormat() == DiagnosticFormat::text)
+        {
+            std::cerr << ac3d.warnings() << " warning";
+            if (ac3d.warnings() > 1)
+                std::cerr << "s";
+            std::cerr << std::endl;
+        }
+
+        if (ac3d.summary())
+        {
+            // warnings with tests
+            showCount(ac3d.ambiguousTextureCount(), "ambiguous texture: ");
+            showCount(ac3d.blankLineCount(), "blank line: ");
+            showCount(ac3d.collinearSurfaceVerticesCount(), "collinear surface vertices: ");
+            showCount(ac3d.differentMatCount(), "different mat: ");
+            showCount(ac3d.differentSURFCount(), "different surf: ");
+            showCount(ac3d.differentUVCount(), "different uv: ");
+            showCount(ac3d.duplicateMaterialsCount(), "duplicate materials: ");
+            showCount(ac3d.duplicateSurfacesCount(), "duplicate surfaces: ");
+            showCount(ac3d.duplicateSurfacesOrderCount(), "duplicate surfaces order: ");
+            showCount(ac3d.duplicateSurfacesWindingCount(), "duplicate surfaces winding: ");
+            showCount(ac3d.duplicateSurfaceVerticesCount(), "duplicate surface vertices: ");
+            showCount(ac3d.duplicateTextureCount(), "duplicate texture: ");
+            showCount(ac3d.duplicateTrianglesCount(), "duplicate triangles: ");
+            showCount(ac3d.duplicateVerticesCount(), "duplicate vertices: ");
+            showCount(ac3d.emptyObjectCount(), "empty object: ");
+            showCount(ac3d.extraObjectCount(), "extra object: ");
+            showCount(ac3d.extraUVCoordinatesCount(), "extra uv coordinates: ");
+            showCount(ac3d.groupWithGeometryCount(), "group with geometry: ");
+            showCount(ac3d.invalidMaterialCount(), "invalid material: ");
+            showCount(ac3d.invalidNormalLengthCount(), "invalid normal length: ");
+            showCount(ac3d.invalidObjectTypeCount(), "invalid object type: ");
+            showCount(ac3d.invalidRefCountCount(), "invalid ref count: ");
+            showCount(ac3d.materialAfterObjectCount(), "material after object: ");
+            showCount(ac3d.missingKidsCount(), "missing kids: ");
+            showCount(ac3d.missingMatCount(), "missing mat: ");
+            showCount(ac3d.missingNormalCount(), "missing normal: ");
+            showCount(ac3d.missingSurfacesCount(), "missing surfaces: ");
+            showCount(ac3d.missingTextureCount(), "missing texture: ");
+            showCount(ac3d.missingUVCoordinatesCount(), "missing uv coordinates: ");
+            showCount(ac3d.multipleCreaseCount(), "multiple crease: ");
+            showCount(ac3d.multipleDataCount(), "multiple data: ");
+            showCount(ac3d.multipleFoldedCount(), "multiple folded: ");
+            showCount(ac3d.multipleHiddenCount(), "multiple hidden: ");
+            showCount(ac3d.multipleLocCount(), "multiple loc: ");
+            showCount(ac3d.multipleLockedCount(), "multiple locked: ");
+            showCount(ac3d.multipleNameCount(), "multiple name: ");
+            showCount(ac3d.multipleRotCount(), "multiple rot: ");
+            showCount(ac3d.multipleShaderCount(), "multiple shader: ");
+            showCount(ac3d.multipleSubdivCount(), "multiple subdiv: ");
+            showCount(ac3d.multipleTexoffCount(), "multiple texoff: ");
+            showCount(ac3d.multipleTexrepCount(), "multiple texrep: ");
+            showCount(ac3d.multipleTextureCount(), "multiple texture: ");
+            showCount(ac3d.multipleUrlCount(), "multiple url: ");
+            showCount(ac3d.multipleWorldCount(), "multiple world: ");
+            showCount(ac3d.overlapping2SidedSurfaceCount(), "overlapping 2 sided surface: ");
+            showCount(ac3d.surface2SidedOpaqueCount(), "surface 2 sided opaque: ");
+            showCount(ac3d.surfaceNotConvexCount(), "surface not convex: ");
+            showCount(ac3d.surfaceNotCoplanarCount(), "surface not coplanar: ");
+            showCount(ac3d.surfaceNoTextureCount(), "surface no texture: ");
+            showCount(ac3d.surfaceSelfIntersectingCount(), "surface self intersecting: ");
+            showCount(ac3d.surfaceStripDegenerateCount(), "surface strip degenerate: ");
+            showCount(ac3d.surfaceStripSizeCount(), "surface strip size: ");
+            showCount(ac3d.surfaceZeroAreaUVCount(), "surface zero area uv: ");
+            showCount(ac3d.trailingTextCount(), "trailing text: ");
+            showCount(ac3d.unsupportedVersionCount(), "unsupported version: ");
+            showCount(ac3d.unusedMaterialCount(), "unused material: ");
+            showCount(ac3d.unusedVertexCount(), "unused vertex: ");
+            showCount(ac3d.utf8BomCount(), "utf8 bom: ");
+
+            // warnings without test
+            showCount(ac3d.floatingPointCount(), "floating point: ");
+            showCount(ac3d.multiplePolygonSurfaceCount(), "multiple polygon surface: ");
+            showCount(ac3d.surfaceStripHoleCount(), "surface strip hole: ");
+            showCount(ac3d.surfaceStripDuplicateTrianglesCount(), "surface strip duplicate triangles: ");
+        }
+    }
+}
+
+void showErrors(const AC3D &ac3d)
+{
+    if (ac3d.errors() > 0)
+    {
+        if (ac3d.diagnosticFormat() == DiagnosticFormat::text)
+        {
+            std::cerr << ac3d.errors() << " error";
+            if (ac3d.errors() > 1)
+                std::cerr << "s";
+            std::cerr << std::endl;
+        }
+
+        if (ac3d.summary())
+        {
+            // errors with tests
+            showCount(ac3d.invalidKidsCountCount(), "invalid kids count: ");
+            showCount(ac3d.invalidMaterialIndexCount(), "invalid material index: ");
+            showCount(ac3d.invalidNormalCount(), "invalid normal: ");
+            showCount(ac3d.invalidNumsurfCount(), "invalid numsurf: ");
+            showCount(ac3d.invalidNumvertCount(), "invalid numvert: ");
+            showCount(ac3d.invalidRefsCountCount(), "invalid refs count: ");
+            showCount(ac3d.invalidSurfaceTypeCount(), "invalid surface type: ");
+            showCount(ac3d.invalidTokenCount(), "invalid token: ");
+            showCount(ac3d.invalidTextureCoordinateCount(), "invalid texture coordinate: ");
+            showCount(ac3d.invalidVertexCount(), "invalid vertex: ");
+            showCount(ac3d.invalidRefVertexIndexCount(), "invalid ref vertex index: ");
+            showCount(ac3d.missingVertexCount(), "missing vertex: ");
+
+            // errors without tests
+            showCount(ac3d.moreSURFThanSpecifiedCount(), "more SURF than specified: ");
+        }
+    }
+}
+
+// Collects SARIF results and writes them in a log when it goes out of scope.
+class SarifLog
+{
+public:
+    explicit SarifLog(std::ostream &out) : m_out(out)
+    {
+    }
+
+    ~SarifLog()
+    {
+        Writer log(m_out);
+
+        writeSarif(log, AC3D::checkNames(), m_results.str());
+    }
+
+    SarifLog(const SarifLog &) = delete;
+    SarifLog &operator=(const SarifLog &) = delete;
+
+    std::ostream &results()
+    {
+        return m_results;
+    }
+
+private:
+    std::ostream       &m_out;
+    std::ostringstream  m_results;
+};
+
+// Gives a stream a different buffer until it goes out of scope.
+class StreamRedirect
+{
+public:
+    StreamRedirect(std::ostream &stream, std::streambuf *buffer) : m_stream(stream), m_buffer(stream.rdbuf(buffer))
+    {
+    }
+
+    ~StreamRedirect()
+    {
+        m_stream.rdbuf(m_buffer);
+    }
+
+    StreamRedirect(const StreamRedirect &) = delete;
+    StreamRedirect &operator=(const StreamRedirect &) = delete;
+
+private:
+    std::ostream   &m_stream;
+    std::streambuf *m_buffer;
+};
+
+// Ties a stream to another one until it goes out of scope.
+class StreamTie
+{
+public:
+    StreamTie(std::ostream &stream, std::ostream *tie) : m_stream(stream), m_tie(stream.tie(tie))
+    {
+    }
+
+    ~StreamTie()
+    {
+        m_stream.tie(m_tie);
+    }
+
+    StreamTie(const StreamTie &) = delete;
+    StreamTie &operator=(const StreamTie &) = delete;
+
+private:
+    std::ostream &m_stream;
+    std::ostream *m_tie;
+};
+
+// Writes the trace when it goes out of scope so it is written however
+// acclint finishes.
+class TraceFile
+{
+public:
+    TraceFile(const Profiler &profiler, const std::string &file) : m_profiler(profiler), m_file(file)
+    {
+    }
+
+    ~TraceFile()
+    {
+        if (!m_profiler.writeTrace(m_file))
+            std::cerr << "Couldn't write trace file: " << m_file << std::endl;
+    }
+
+    TraceFile(const TraceFile &) = delete;
+    TraceFile &operator=(const TraceFile &) = delete;
+
+private:
+    const Profiler &m_profiler;
+    std::string     m_file;
+};
+
 } // namespace
 
 int main(int argc, char *argv[])
@@ -189,7 +418,7 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    std::string in_file;
+    std::vector<std::string> in_files;
     std::string out_file;
 
     // warnings with tests
@@ -278,6 +507,19 @@ int main(int argc, char *argv[])
     bool not_ac3d_file = true;
 
     std::vector<std::string> texture_paths;
+    std::string texture_cache_file;
+    bool compare_textures = false;
+    int compression_level = -1;
+    bool copy_unchanged = false;
+    std::string diagnostics_file;
+    int diagnostics_fd = -1;
+    std::optional<DiagnosticBuf::Policy> flush_policy;
+    size_t flush_lines = 1;
+    DiagnosticFormat diagnostic_format = DiagnosticFormat::text;
+    bool source_excerpts = false;
+    size_t max_diagnostics = std::numeric_limits<size_t>::max();
+    std::string trace_file;
+    std::vector<std::pair<std::string, size_t>> max_check_diagnostics;
     bool fix_surface_2_sided_opaque = false;
     bool dump = false;
     bool splitSURF = false;
@@ -291,6 +533,8 @@ int main(int argc, char *argv[])
     std::vector<std::string> merge_files;
     std::vector<AC3D::RemoveInfo> removes;
     bool show_times = false;
+    bool show_stats = false;
+    bool memory_report = false;
     bool quiet = false;
     bool summary = false;
     unsigned int threads = 1;
@@ -318,9 +562,24 @@ int main(int argc, char *argv[])
         OPT_SHOW_TIMES,
         OPT_QUIET,
         OPT_SUMMARY,
+        OPT_TEXTURE_CACHE,
+        OPT_COMPARE_TEXTURES,
+        OPT_COMPRESSION_LEVEL,
+        OPT_COPY_UNCHANGED,
+        OPT_DIAGNOSTICS,
+        OPT_DIAGNOSTICS_FD,
+        OPT_FLUSH_DIAGNOSTICS,
+        OPT_FORMAT,
+        OPT_SOURCE_EXCERPTS,
+        OPT_MAX_DIAGNOSTICS,
+        OPT_TRACE,
+        OPT_STATS,
+        OPT_MEMORY_REPORT,
+        // --max-<warning> for each warning, must be last
+        OPT_MAX_CHECK_DIAGNOSTICS,
     };
 
-    static const struct option long_options[] = {
+    static const struct option options[] = {
         { "version",                     no_argument,       nullptr, OPT_VERSION },
         { "help",                        no_argument,       nullptr, OPT_HELP },
         { "splitSURF",                   no_argument,       nullptr, OPT_SPLIT_SURF },
@@ -336,9 +595,33 @@ int main(int argc, char *argv[])
         { "showTimes",                   no_argument,       nullptr, OPT_SHOW_TIMES },
         { "quiet",                       no_argument,       nullptr, OPT_QUIET },
         { "summary",                     no_argument,       nullptr, OPT_SUMMARY },
-        { nullptr, 0, nullptr, 0 }
+        { "textureCache",                required_argument, nullptr, OPT_TEXTURE_CACHE },
+        { "compareTextures",             no_argument,       nullptr, OPT_COMPARE_TEXTURES },
+        { "compressionLevel",            required_argument, nullptr, OPT_COMPRESSION_LEVEL },
+        { "copyUnchanged",               no_argument,       nullptr, OPT_COPY_UNCHANGED },
+        { "diagnostics",                 required_argument, nullptr, OPT_DIAGNOSTICS },
+        { "diagnosticsFd",               required_argument, nullptr, OPT_DIAGNOSTICS_FD },
+        { "flushDiagnostics",            required_argument, nullptr, OPT_FLUSH_DIAGNOSTICS },
+        { "format",                      required_argument, nullptr, OPT_FORMAT },
+        { "sourceExcerpts",              no_argument,       nullptr, OPT_SOURCE_EXCERPTS },
+        { "max-diagnostics",             required_argument, nullptr, OPT_MAX_DIAGNOSTICS },
+        { "trace",                       required_argument, nullptr, OPT_TRACE },
+        { "stats",                       no_argument,       nullptr, OPT_STATS },
+        { "memory-report",               no_argument,       nullptr, OPT_MEMORY_REPORT },
     };
 
+    const std::vector<std::string> check_names = AC3D::checkNames();
+    std::vector<std::string> max_check_options;
+    std::vector<struct option> long_options(std::begin(options), std::end(options));
+
+    max_check_options.reserve(check_names.size());
+    for (size_t i = 0; i < check_names.size(); ++i)
+    {
+        max_check_options.push_back("max-" + check_names[i]);
+        long_options.push_back({ max_check_options.back().c_str(), required_argument, nullptr, OPT_MAX_CHECK_DIAGNOSTICS + static_cast<int>(i) });
+    }
+    long_options.push_back({ nullptr, 0, nullptr, 0 });
+
     // "-Wxxx"/"-Wno-xxx" are handled as the short option 'W' with its value
     // attached directly (e.g. "-Wno-blank-line" -> option 'W', optarg
     // "no-blank-line"), the same way GCC's own -W flags work. A leading ':'
@@ -348,7 +631,7 @@ int main(int argc, char *argv[])
     opterr = 0;
 
     int c;
-    while ((c = getopt_long(argc, argv, ":o:T:j:v:lW:", long_options, nullptr)) != -1)
+    while ((c = getopt_long(argc, argv, ":o:T:j:v:lW:", long_options.data(), nullptr)) != -1)
     {
         switch (c)
         {
@@ -474,12 +757,110 @@ int main(int argc, char *argv[])
         case OPT_SHOW_TIMES:
             show_times = true;
             break;
+        case OPT_STATS:
+            show_stats = true;
+            break;
+        case OPT_MEMORY_REPORT:
+            memory_report = true;
+            break;
         case OPT_QUIET:
             quiet = true;
             break;
         case OPT_SUMMARY:
             summary = true;
             break;
+        case OPT_TEXTURE_CACHE:
+            texture_cache_file = optarg;
+            break;
+        case OPT_COMPARE_TEXTURES:
+            compare_textures = true;
+            break;
+        case OPT_COMPRESSION_LEVEL:
+        {
+            std::istringstream iss(optarg);
+            iss >> compression_level;
+            if (!iss || !iss.eof() || compression_level < 0 || compression_level > 9)
+            {
+                std::cerr << "Invalid compression level: " << optarg << std::endl;
+                usage();
+                return EXIT_FAILURE;
+            }
+            break;
+        }
+        case OPT_COPY_UNCHANGED:
+            copy_unchanged = true;
+            break;
+        case OPT_DIAGNOSTICS:
+            diagnostics_file = optarg;
+            break;
+        case OPT_DIAGNOSTICS_FD:
+        {
+            std::istringstream iss(optarg);
+            iss >> diagnostics_fd;
+            if (!iss || !iss.eof() || diagnostics_fd < 0)
+            {
+                std::cerr << "Invalid file descriptor: " << optarg << std::endl;
+                usage();
+                return EXIT_FAILURE;
+            }
+            break;
+        }
+        case OPT_FLUSH_DIAGNOSTICS:
+        {
+            const std::string policy = optarg;
+            if (policy == "error")
+                flush_policy = DiagnosticBuf::Policy::error;
+            else if (policy == "exit")
+                flush_policy = DiagnosticBuf::Policy::exit;
+            else
+            {
+                std::istringstream iss(policy);
+                iss >> flush_lines;
+                if (!iss || !iss.eof() || flush_lines < 1 || policy[0] == '-')
+                {
+                    std::cerr << "Invalid flush policy: " << policy << std::endl;
+                    usage();
+                    return EXIT_FAILURE;
+                }
+                flush_policy = DiagnosticBuf::Policy::lines;
+            }
+            break;
+        }
+        case OPT_FORMAT:
+        {
+            const std::string format = optarg;
+            if (format == "text")
+                diagnostic_format = DiagnosticFormat::text;
+            else if (format == "jsonl")
+                diagnostic_format = DiagnosticFormat::jsonl;
+            else if (format == "sarif")
+                diagnostic_format = DiagnosticFormat::sarif;
+            else
+            {
+                std::cerr << "Invalid format: " << format << std::endl;
+                usage();
+                return EXIT_FAILURE;
+            }
+            break;
+        }
+        case OPT_SOURCE_EXCERPTS:
+            source_excerpts = true;
+            break;
+        case OPT_TRACE:
+            trace_file = optarg;
+            break;
+        case OPT_MAX_DIAGNOSTICS:
+        {
+            std::istringstream iss(optarg);
+            iss >> max_diagnostics;
+            if (!iss || !iss.eof() || optarg[0] == '-')
+            {
+                std::cerr << "Invalid maximum number of diagnostics: " << optarg << std::endl;
+                usage();
+                return EXIT_FAILURE;
+            }
+            break;
+        }
 
         case 'W':
         {
@@ -936,8 +1317,32 @@ int main(int argc, char *argv[])
             case OPT_REMOVE_OBJECTS:
                 std::cerr << "Missing removeObjects parameters" << std::endl;
                 break;
+            case OPT_COMPRESSION_LEVEL:
+                std::cerr << "Missing compression level" << std::endl;
+                break;
+            case OPT_DIAGNOSTICS:
+                std::cerr << "Missing diagnostics file" << std::endl;
+                break;
+            case OPT_DIAGNOSTICS_FD:
+                std::cerr << "Missing diagnostics file descriptor" << std::endl;
+                break;
+            case OPT_FLUSH_DIAGNOSTICS:
+                std::cerr << "Missing flush policy" << std::endl;
+                break;
+            case OPT_FORMAT:
+                std::cerr << "Missing format" << std::endl;
+                break;
+            case OPT_MAX_DIAGNOSTICS:
+                std::cerr << "Missing maximum number of diagnostics" << std::endl;
+                break;
+            case OPT_TRACE:
+                std::cerr << "Missing trace file" << std::endl;
+                break;
             default:
-                std::cerr << "Unknown option: " << argv[optind - 1] << std::endl;
+                if (optopt >= OPT_MAX_CHECK_DIAGNOSTICS && optopt < OPT_MAX_CHECK_DIAGNOSTICS + static_cast<int>(check_names.size()))
+                    std::cerr << "Missing maximum number of " << check_names[static_cast<size_t>(optopt - OPT_MAX_CHECK_DIAGNOSTICS)] << " diagnostics" << std::endl;
+                else
+                    std::cerr << "Unknown option: " << argv[optind - 1] << std::endl;
                 break;
             }
 
@@ -948,6 +1353,22 @@ int main(int argc, char *argv[])
         case '?':
         default:
         {
+            if (c >= OPT_MAX_CHECK_DIAGNOSTICS && c < OPT_MAX_CHECK_DIAGNOSTICS + static_cast<int>(check_names.size()))
+            {
+                const std::string &name = check_names[static_cast<size_t>(c - OPT_MAX_CHECK_DIAGNOSTICS)];
+                size_t max = 0;
+                std::istringstream iss(optarg);
+                iss >> max;
+                if (!iss || !iss.eof() || optarg[0] == '-')
+                {
+                    std::cerr << "Invalid maximum number of " << name << " diagnostics: " << optarg << std::endl;
+                    usage();
+                    return EXIT_FAILURE;
+                }
+                max_check_diagnostics.emplace_back(name, max);
+                break;
+            }
+
             // optopt identifies the offending character for an
             // unrecognized (or bundled) short option, e.g. "-lx" sets
             // optopt to 'x'. It's only meaningful in the short-option
@@ -965,19 +1386,66 @@ int main(int argc, char *argv[])
     }
 
     for (int idx = optind; idx < argc; ++idx)
+        in_files.emplace_back(argv[idx]);
+
+    // there is nowhere to put more than one output file
+    if (in_files.size() > 1 && !out_file.empty())
     {
-        const std::string arg = argv[idx];
+        std::cerr << "Multiple input files not supported with -o: " << in_files[1] << std::endl;
+        usage();
+        return EXIT_FAILURE;
+    }
 
-        if (in_file.empty())
-            in_file = arg;
-        else
-        {
-            std::cerr << "Multiple input files not supported: " << arg << std::endl;
-            usage();
-            return EXIT_FAILURE;
-        }
+    // The warnings and errors are buffered. The buffer is written when it
+    // goes out of scope.
+    DiagnosticBuf diagnostics;
+
+    if (!diagnostics_file.empty() && !diagnostics.open(diagnostics_file))
+    {
+        std::cerr << "Couldn't open diagnostics file: " << diagnostics_file << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (diagnostics_fd != -1 && !diagnostics.open(diagnostics_fd))
+    {
+        std::cerr << "Couldn't open diagnostics file descriptor: " << diagnostics_fd << std::endl;
+        return EXIT_FAILURE;
     }
 
+    // Like stdio, a line at a time to a terminal so warnings are seen as
+    // they are found, otherwise when the buffer is full or at exit.
+    if (!flush_policy)
+        flush_policy = diagnostics.terminal() ? DiagnosticBuf::Policy::lines : DiagnosticBuf::Policy::exit;
+
+    diagnostics.policy(*flush_policy, flush_lines);
+
+    std::ostream diagnostics_out(&diagnostics);
+
+    // Diagnostics and other output are written in the order they were
+    // made: each is flushed before the other is written.
+    diagnostics_out.tie(&std::cout);
+
+    DiagnosticBuf::Flusher flusher(diagnostics);
+    std::ostream flush_diagnostics(&flusher);
+    const StreamTie tie(std::cout, &flush_diagnostics);
+
+    // Text diagnostics are mixed with the other messages written to
+    // std::cerr so they go through the same buffer to stay in order until
+    // std::cerr is given its own buffer back. Machine readable ones only
+    // go to the diagnostics.
+    std::optional<StreamRedirect> redirect;
+
+    if (diagnostic_format == DiagnosticFormat::text)
+        redirect.emplace(std::cerr, &diagnostics);
+
+    // SARIF results are collected and written in one log at exit
+    std::optional<SarifLog> sarif;
+
+    if (diagnostic_format == DiagnosticFormat::sarif)
+        sarif.emplace(diagnostics_out);
+
+    std::ostream &errors = sarif ? sarif->results() : diagnostics_out;
+
     std::chrono::time_point<std::chrono::system_clock> start;
 
     if (show_times)
@@ -986,97 +1454,224 @@ int main(int argc, char *argv[])
         std::cout << "acclint started at " << AC3D::getTime(start) << std::endl;
     }
 
-    AC3D ac3d;
+    TextureCache texture_cache;
 
-    // warnings with tests
-    ac3d.ambiguousTexture(ambiguous_texture);
-    ac3d.blankLine(blank_line);
-    ac3d.collinearSurfaceVertices(collinear_surface_vertices);
-    ac3d.differentMat(different_mat);
-    ac3d.differentSURF(different_surf);
-    ac3d.differentUV(different_uv);
-    ac3d.duplicateMaterials(duplicate_materials);
-    ac3d.duplicateSurfaces(duplicate_surfaces);
-    ac3d.duplicateSurfacesOrder(duplicate_surfaces_order);
-    ac3d.duplicateSurfacesWinding(duplicate_surfaces_winding);
-    ac3d.duplicateSurfaceVertices(duplicate_surface_vertices);
-    ac3d.duplicateTriangles(duplicate_triangles);
-    ac3d.duplicateTexture(duplicate_texture);
-    ac3d.duplicateVertices(duplicate_vertices);
-    ac3d.emptyObject(empty_object);
-    ac3d.extraObject(extra_object);
-    ac3d.extraUVCoordinates(extra_uv_coordinates);
-    ac3d.floatingPoint(floating_point);
-    ac3d.groupWithGeometry(group_with_geometry);
-    ac3d.invalidMaterial(invalid_material);
-    ac3d.invalidNormalLength(invalid_normal_length);
-    ac3d.invalidObjectType(invalid_object_type);
-    ac3d.invalidRefCount(invalid_ref_count);
-    ac3d.materialAfterObject(material_after_object);
-    ac3d.missingKids(missing_kids);
-    ac3d.missingMat(missing_mat);
-    ac3d.missingNormal(missing_normal);
-    ac3d.missingSurfaces(missing_surfaces);
-    ac3d.missingTexture(missing_texture);
-    ac3d.missingUVCoordinates(missing_uv_coordinates);
-    ac3d.multipleCrease(multiple_crease);
-    ac3d.multipleData(multiple_data);
-    ac3d.multipleFolded(multiple_folded);
-    ac3d.multipleHidden(multiple_hidden);
-    ac3d.multipleLoc(multiple_loc);
-    ac3d.multipleLocked(multiple_locked);
-    ac3d.multipleName(multiple_name);
-    ac3d.multipleRot(multiple_rot);
-    ac3d.multipleShader(multiple_shader);
-    ac3d.multipleSubdiv(multiple_subdiv);
-    ac3d.multipleTexoff(multiple_texoff);
-    ac3d.multipleTexrep(multiple_texrep);
-    ac3d.multipleTexture(multiple_texture);
-    ac3d.multipleUrl(multiple_url);
-    ac3d.multipleWorld(multiple_world);
-    ac3d.overlapping2SidedSurface(overlapping_2_sided_surface);
-    ac3d.surface2SidedOpaque(surface_2_sided_opaque);
-    ac3d.surfaceNotConvex(surface_not_convex);
-    ac3d.surfaceNotCoplanar(surface_not_coplanar);
-    ac3d.surfaceNoTexture(surface_no_texture);
-    ac3d.surfaceSelfIntersecting(surface_self_intersecting);
-    ac3d.surfaceStripDegenerate(surface_strip_degenerate);
-    ac3d.surfaceStripSize(surface_strip_size);
-    ac3d.surfaceZeroAreaUV(surface_zero_area_uv);
-    ac3d.trailingText(trailing_text);
-    ac3d.unsupportedVersion(unsupported_version);
-    ac3d.unusedMaterial(unused_material);
-    ac3d.unusedVertex(unused_vertex);
-    ac3d.utf8Bom(utf8_bom);
+    // shown at the end with --showTimes or written to the --trace file
+    Profiler profiler;
+    std::optional<TraceFile> trace;
 
-    // warnings without tests
-    ac3d.multiplePolygonSurface(multiple_polygon_surface);
-    ac3d.surfaceStripHole(surface_strip_hole);
-    ac3d.surfaceStripDuplicateTriangles(surface_strip_duplicate_triangles);
+    if (!trace_file.empty())
+    {
+        profiler.tracing(true);
+        trace.emplace(profiler, trace_file);
+    }
 
-    // errors with tests
-    ac3d.invalidKidsCount(invalid_kids_count);
-    ac3d.invalidMaterialIndex(invalid_material_index);
-    ac3d.invalidNormal(invalid_normal);
-    ac3d.invalidNumsurf(invalid_numsurf);
-    ac3d.invalidNumvert(invalid_numvert);
-    ac3d.invalidRefsCount(invalid_refs_count);
-    ac3d.invalidSurfaceType(invalid_surface_type);
-    ac3d.invalidToken(invalid_token);
-    ac3d.invalidTextureCoordinate(invalid_texture_coordinate);
-    ac3d.invalidVertex(invalid_vertex);
-    ac3d.invalidRefVertexIndex(invalid_ref_vertex_index);
-    ac3d.missingVertex(missing_vertex);
-    ac3d.moreSURFThanSpecified(more_surf_than_specified);
+    // shown at the end with --stats
+    Stats stats;
 
-    // errors without tests
+    // every input file is checked with the same settings
+    auto configure = [&](AC3D &ac3d)
+    {
+        // warnings with tests
+        ac3d.ambiguousTexture(ambiguous_texture);
+        ac3d.blankLine(blank_line);
+        ac3d.collinearSurfaceVertices(collinear_surface_vertices);
+        ac3d.differentMat(different_mat);
+        ac3d.differentSURF(different_surf);
+        ac3d.differentUV(different_uv);
+        ac3d.duplicateMaterials(duplicate_materials);
+        ac3d.duplicateSurfaces(duplicate_surfaces);
+        ac3d.duplicateSurfacesOrder(duplicate_surfaces_order);
+        ac3d.duplicateSurfacesWinding(duplicate_surfaces_winding);
+        ac3d.duplicateSurfaceVertices(duplicate_surface_vertices);
+        ac3d.duplicateTriangles(duplicate_triangles);
+        ac3d.duplicateTexture(duplicate_texture);
+        ac3d.duplicateVertices(duplicate_vertices);
+        ac3d.emptyObject(empty_object);
+        ac3d.extraObject(extra_object);
+        ac3d.extraUVCoordinates(extra_uv_coordinates);
+        ac3d.floatingPoint(floating_point);
+        ac3d.groupWithGeometry(group_with_geometry);
+        ac3d.invalidMaterial(invalid_material);
+        ac3d.invalidNormalLength(invalid_normal_length);
+        ac3d.invalidObjectType(invalid_object_type);
+        ac3d.invalidRefCount(invalid_ref_count);
+        ac3d.materialAfterObject(material_after_object);
+        ac3d.missingKids(missing_kids);
+        ac3d.missingMat(missing_mat);
+        ac3d.missingNormal(missing_normal);
+        ac3d.missingSurfaces(missing_surfaces);
+        ac3d.missingTexture(missing_texture);
+        ac3d.missingUVCoordinates(missing_uv_coordinates);
+        ac3d.multipleCrease(multiple_crease);
+        ac3d.multipleData(multiple_data);
+        ac3d.multipleFolded(multiple_folded);
+        ac3d.multipleHidden(multiple_hidden);
+        ac3d.multipleLoc(multiple_loc);
+        ac3d.multipleLocked(multiple_locked);
+        ac3d.multipleName(multiple_name);
+        ac3d.multipleRot(multiple_rot);
+        ac3d.multipleShader(multiple_shader);
+        ac3d.multipleSubdiv(multiple_subdiv);
+        ac3d.multipleTexoff(multiple_texoff);
+        ac3d.multipleTexrep(multiple_texrep);
+        ac3d.multipleTexture(multiple_texture);
+        ac3d.multipleUrl(multiple_url);
+        ac3d.multipleWorld(multiple_world);
+        ac3d.overlapping2SidedSurface(overlapping_2_sided_surface);
+        ac3d.surface2SidedOpaque(surface_2_sided_opaque);
+        ac3d.surfaceNotConvex(surface_not_convex);
+        ac3d.surfaceNotCoplanar(surface_not_coplanar);
+        ac3d.surfaceNoTexture(surface_no_texture);
+        ac3d.surfaceSelfIntersecting(surface_self_intersecting);
+        ac3d.surfaceStripDegenerate(surface_strip_degenerate);
+        ac3d.surfaceStripSize(surface_strip_size);
+        ac3d.surfaceZeroAreaUV(surface_zero_area_uv);
+        ac3d.trailingText(trailing_text);
+        ac3d.unsupportedVersion(unsupported_version);
+        ac3d.unusedMaterial(unused_material);
+        ac3d.unusedVertex(unused_vertex);
+        ac3d.utf8Bom(utf8_bom);
+
+        // warnings without tests
+        ac3d.multiplePolygonSurface(multiple_polygon_surface);
+        ac3d.surfaceStripHole(surface_strip_hole);
+        ac3d.surfaceStripDuplicateTriangles(surface_strip_duplicate_triangles);
+
+        // errors with tests
+        ac3d.invalidKidsCount(invalid_kids_count);
+        ac3d.invalidMaterialIndex(invalid_material_index);
+        ac3d.invalidNormal(invalid_normal);
+        ac3d.invalidNumsurf(invalid_numsurf);
+        ac3d.invalidNumvert(invalid_numvert);
+        ac3d.invalidRefsCount(invalid_refs_count);
+        ac3d.invalidSurfaceType(invalid_surface_type);
+        ac3d.invalidToken(invalid_token);
+        ac3d.invalidTextureCoordinate(invalid_texture_coordinate);
+        ac3d.invalidVertex(invalid_vertex);
+        ac3d.invalidRefVertexIndex(invalid_ref_vertex_index);
+        ac3d.missingVertex(missing_vertex);
+        ac3d.moreSURFThanSpecified(more_surf_than_specified);
+
+        // errors without tests
+
+        ac3d.notAC3DFile(not_ac3d_file);
+        ac3d.texturePaths(texture_paths);
+        ac3d.showTimes(show_times);
+        ac3d.quiet(quiet);
+        ac3d.summary(summary);
+        ac3d.threads(threads);
+        ac3d.textureCache(texture_cache_file.empty() ? nullptr : &texture_cache);
+        ac3d.profiler(show_times || trace ? &profiler : nullptr);
+        ac3d.stats(show_stats ? &stats : nullptr);
+        ac3d.compareTextures(compare_textures);
+        ac3d.compressionLevel(compression_level);
+        ac3d.copyUnchanged(copy_unchanged);
+        ac3d.diagnosticFormat(diagnostic_format);
+        ac3d.sourceExcerpts(source_excerpts);
+        ac3d.maxDiagnostics(max_diagnostics);
+        for (const auto &max : max_check_diagnostics)
+            ac3d.maxDiagnostics(max.first, max.second);
+        ac3d.errorStream(errors);
+        ac3d.diagnosticBuf(&diagnostics);
+    };
+
+    // saved when it goes out of scope after all the files are done
+    if (!texture_cache_file.empty())
+        texture_cache.load(texture_cache_file);
+
+    // shared by all the files and the parallel parts of each file
+    ThreadPool pool(threads);
+
+    if (in_files.size() > 1)
+    {
+        // Check the files in parallel. The output of each file is kept
+        // separate and shown in the order the files were given as soon
+        // as that file and all the files before it are done.
+        struct Output
+        {
+            std::ostringstream out;
+            std::ostringstream err;
+            bool error = false;
+            bool done = false;
+        };
+
+        std::vector<Output> outputs(in_files.size());
+        std::mutex mutex;
+        size_t next = 0;
+        bool failed = false;
+        AC3D totals;
+        ThreadPool::TaskGroup group;
+
+        totals.summary(summary);
+        totals.diagnosticFormat(diagnostic_format);
+
+        for (size_t i = 0; i < in_files.size(); ++i)
+        {
+            pool.run(group, [&, i]
+            {
+                Output &output = outputs[i];
+                AC3D ac3d;
+
+                configure(ac3d);
+                ac3d.threadPool(&pool);
+                ac3d.outputStream(output.out);
+                ac3d.errorStream(output.err);
+                ac3d.diagnosticBuf(nullptr);
+
+                if (listInput)
+                    (diagnostic_format == DiagnosticFormat::text ? output.err : output.out) << in_files[i] << std::endl;
+
+                const bool read = ac3d.read(in_files[i]);
+
+                if (read && dump)
+                    ac3d.dump(dump_type);
+
+                if (read && memory_report)
+                    ac3d.memoryReport("read");
 
-    ac3d.notAC3DFile(not_ac3d_file);
-    ac3d.texturePaths(texture_paths);
-    ac3d.showTimes(show_times);
-    ac3d.quiet(quiet);
-    ac3d.summary(summary);
-    ac3d.threads(threads);
+                ac3d.finishDiagnostics();
+
+                const std::lock_guard<std::mutex> lock(mutex);
+
+                totals.addCounts(ac3d);
+                failed |= !read;
+                output.error = ac3d.errors() != 0;
+                output.done = true;
+
+                while (next < outputs.size() && outputs[next].done)
+                {
+                    std::cout << outputs[next].out.str() << std::flush;
+                    if (outputs[next].error)
+                        diagnostics.error();
+                    errors << outputs[next].err.str() << std::flush;
+                    outputs[next].out.str(std::string());
+                    outputs[next].err.str(std::string());
+                    next++;
+                }
+            });
+        }
+
+        pool.wait(group);
+
+        // the worst file decides the exit status
+        showWarnings(totals);
+        showErrors(totals);
+
+        if (show_times)
+        {
+            const std::chrono::time_point<std::chrono::system_clock> end = std::chrono::system_clock::now();
+            std::cout << "acclint finished at " << AC3D::getTime(end) << " duration: " << AC3D::getDuration(start, end) << std::endl;
+            profiler.report(std::cout);
+        }
+
+        if (show_stats)
+            stats.report(std::cout);
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    const std::string in_file = in_files.empty() ? std::string() : in_files[0];
 
     if (listInput)
         std::cerr << in_file << std::endl;
@@ -1088,9 +1683,14 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    AC3D ac3d;
+
+    configure(ac3d);
+    ac3d.threadPool(&pool);
+
     if (!ac3d.read(in_file))
     {
-        if (ac3d.errors() > 0)
+        if (ac3d.errors() > 0 && diagnostic_format == DiagnosticFormat::text)
         {
             std::cerr << ac3d.errors() << " error";
             if (ac3d.errors() > 1)
@@ -1100,110 +1700,17 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    if (ac3d.warnings() > 0)
-    {
-        std::cerr << ac3d.warnings() << " warning";
-        if (ac3d.warnings() > 1)
-            std::cerr << "s";
-        std::cerr << std::endl;
+    showWarnings(ac3d);
+    showErrors(ac3d);
 
-        if (ac3d.summary())
-        {
-            // warnings with tests
-            showCount(ac3d.ambiguousTextureCount(), "ambiguous texture: ");
-            showCount(ac3d.blankLineCount(), "blank line: ");
-            showCount(ac3d.collinearSurfaceVerticesCount(), "collinear surface vertices: ");
-            showCount(ac3d.differentMatCount(), "different mat: ");
-            showCount(ac3d.differentSURFCount(), "different surf: ");
-            showCount(ac3d.differentUVCount(), "different uv: ");
-            showCount(ac3d.duplicateMaterialsCount(), "duplicate materials: ");
-            showCount(ac3d.duplicateSurfacesCount(), "duplicate surfaces: ");
-            showCount(ac3d.duplicateSurfacesOrderCount(), "duplicate surfaces order: ");
-            showCount(ac3d.duplicateSurfacesWindingCount(), "duplicate surfaces winding: ");
-            showCount(ac3d.duplicateSurfaceVerticesCount(), "duplicate surface vertices: ");
-            showCount(ac3d.duplicateTextureCount(), "duplicate texture: ");
-            showCount(ac3d.duplicateTrianglesCount(), "duplicate triangles: ");
-            showCount(ac3d.duplicateVerticesCount(), "duplicate vertices: ");
-            showCount(ac3d.emptyObjectCount(), "empty object: ");
-            showCount(ac3d.extraObjectCount(), "extra object: ");
-            showCount(ac3d.extraUVCoordinatesCount(), "extra uv coordinates: ");
-            showCount(ac3d.groupWithGeometryCount(), "group with geometry: ");
-            showCount(ac3d.invalidMaterialCount(), "invalid material: ");
-            showCount(ac3d.invalidNormalLengthCount(), "invalid normal length: ");
-            showCount(ac3d.invalidObjectTypeCount(), "invalid object type: ");
-            showCount(ac3d.invalidRefCountCount(), "invalid ref count: ");
-            showCount(ac3d.materialAfterObjectCount(), "material after object: ");
-            showCount(ac3d.missingKidsCount(), "missing kids: ");
-            showCount(ac3d.missingMatCount(), "missing mat: ");
-            showCount(ac3d.missingNormalCount(), "missing normal: ");
-            showCount(ac3d.missingSurfacesCount(), "missing surfaces: ");
-            showCount(ac3d.missingTextureCount(), "missing texture: ");
-            showCount(ac3d.missingUVCoordinatesCount(), "missing uv coordinates: ");
-            showCount(ac3d.multipleCreaseCount(), "multiple crease: ");
-            showCount(ac3d.multipleDataCount(), "multiple data: ");
-            showCount(ac3d.multipleFoldedCount(), "multiple folded: ");
-            showCount(ac3d.multipleHiddenCount(), "multiple hidden: ");
-            showCount(ac3d.multipleLocCount(), "multiple loc: ");
-            showCount(ac3d.multipleLockedCount(), "multiple locked: ");
-            showCount(ac3d.multipleNameCount(), "multiple name: ");
-            showCount(ac3d.multipleRotCount(), "multiple rot: ");
-            showCount(ac3d.multipleShaderCount(), "multiple shader: ");
-            showCount(ac3d.multipleSubdivCount(), "multiple subdiv: ");
-            showCount(ac3d.multipleTexoffCount(), "multiple texoff: ");
-            showCount(ac3d.multipleTexrepCount(), "multiple texrep: ");
-            showCount(ac3d.multipleTextureCount(), "multiple texture: ");
-            showCount(ac3d.multipleUrlCount(), "multiple url: ");
-            showCount(ac3d.multipleWorldCount(), "multiple world: ");
-            showCount(ac3d.overlapping2SidedSurfaceCount(), "overlapping 2 sided surface: ");
-            showCount(ac3d.surface2SidedOpaqueCount(), "surface 2 sided opaque: ");
-            showCount(ac3d.surfaceNotConvexCount(), "surface not convex: ");
-            showCount(ac3d.surfaceNotCoplanarCount(), "surface not coplanar: ");
-            showCount(ac3d.surfaceNoTextureCount(), "surface no texture: ");
-            showCount(ac3d.surfaceSelfIntersectingCount(), "surface self intersecting: ");
-            showCount(ac3d.surfaceStripDegenerateCount(), "surface strip degenerate: ");
-            showCount(ac3d.surfaceStripSizeCount(), "surface strip size: ");
-            showCount(ac3d.surfaceZeroAreaUVCount(), "surface zero area uv: ");
-            showCount(ac3d.trailingTextCount(), "trailing text: ");
-            showCount(ac3d.unsupportedVersionCount(), "unsupported version: ");
-            showCount(ac3d.unusedMaterialCount(), "unused material: ");
-            showCount(ac3d.unusedVertexCount(), "unused vertex: ");
-            showCount(ac3d.utf8BomCount(), "utf8 bom: ");
-
-            // warnings without test
-            showCount(ac3d.floatingPointCount(), "floating point: ");
-            showCount(ac3d.multiplePolygonSurfaceCount(), "multiple polygon surface: ");
-            showCount(ac3d.surfaceStripHoleCount(), "surface strip hole: ");
-            showCount(ac3d.surfaceStripDuplicateTrianglesCount(), "surface strip duplicate triangles: ");
-        }
-    }
-
-    if (ac3d.errors() > 0)
+    // after each part that changes the model
+    const auto showMemory = [&ac3d, memory_report](const char *phase)
     {
-        std::cerr << ac3d.errors() << " error";
-        if (ac3d.errors() > 1)
-            std::cerr << "s";
-        std::cerr << std::endl;
-
-        if (ac3d.summary())
-        {
-            // errors with tests
-            showCount(ac3d.invalidKidsCountCount(), "invalid kids count: ");
-            showCount(ac3d.invalidMaterialIndexCount(), "invalid material index: ");
-            showCount(ac3d.invalidNormalCount(), "invalid normal: ");
-            showCount(ac3d.invalidNumsurfCount(), "invalid numsurf: ");
-            showCount(ac3d.invalidNumvertCount(), "invalid numvert: ");
-            showCount(ac3d.invalidRefsCountCount(), "invalid refs count: ");
-            showCount(ac3d.invalidSurfaceTypeCount(), "invalid surface type: ");
-            showCount(ac3d.invalidTokenCount(), "invalid token: ");
-            showCount(ac3d.invalidTextureCoordinateCount(), "invalid texture coordinate: ");
-            showCount(ac3d.invalidVertexCount(), "invalid vertex: ");
-            showCount(ac3d.invalidRefVertexIndexCount(), "invalid ref vertex index: ");
-            showCount(ac3d.missingVertexCount(), "missing vertex: ");
+        if (memory_report)
+            ac3d.memoryReport(phase);
+    };
 
-            // errors without tests
-            showCount(ac3d.moreSURFThanSpecifiedCount(), "more SURF than specified: ");
-        }
-    }
+    showMemory("read");
 
     if (!out_file.empty())
     {
@@ -1219,9 +1726,16 @@ int main(int argc, char *argv[])
 
             AC3D to_merge;
 
+            to_merge.profiler(show_times || trace ? &profiler : nullptr);
+            to_merge.stats(show_stats ? &stats : nullptr);
+            to_merge.diagnosticFormat(diagnostic_format);
+            to_merge.sourceExcerpts(source_excerpts);
+            to_merge.errorStream(errors);
+            to_merge.diagnosticBuf(&diagnostics);
+
             if (!to_merge.read(filename))
             {
-                if (to_merge.errors() > 0)
+                if (to_merge.errors() > 0 && diagnostic_format == DiagnosticFormat::text)
                 {
                     std::cerr << to_merge.errors() << " error";
                     if (to_merge.errors() > 1)
@@ -1232,7 +1746,7 @@ int main(int argc, char *argv[])
                 return EXIT_FAILURE;
             }
 
-            if (to_merge.warnings() > 0)
+            if (to_merge.warnings() > 0 && diagnostic_format == DiagnosticFormat::text)
             {
                 std::cerr << to_merge.warnings() << " warning";
                 if (to_merge.warnings() > 1)
@@ -1240,7 +1754,7 @@ int main(int argc, char *argv[])
                 std::cerr << std::endl;
             }
 
-            if (to_merge.errors() > 0)
+            if (to_merge.errors() > 0 && diagnostic_format == DiagnosticFormat::text)
             {
                 std::cerr << to_merge.errors() << " error";
                 if (to_merge.errors() > 1)
@@ -1255,13 +1769,18 @@ int main(int argc, char *argv[])
                 std::cerr << "Couldn't merge " << filename << std::endl;
                 return EXIT_FAILURE;
             }
+
+            showMemory("merge");
         }
 
         for (const auto &remove : removes)
             ac3d.removeObjects(remove);
 
         if (flatten)
+        {
             ac3d.flatten();
+            showMemory("flatten");
+        }
 
         if (splitPolygon)
             ac3d.splitPolygons();
@@ -1275,9 +1794,13 @@ int main(int argc, char *argv[])
         ac3d.fixMultipleWorlds();
 
         ac3d.clean();
+        showMemory("clean");
 
         if (fix_surface_2_sided_opaque)
+        {
             ac3d.fixSurface2SidedOpaque();
+            showMemory("fixSurface2SidedOpaque");
+        }
 
         if (fix_overlapping_2_sided_surface)
         {
@@ -1285,12 +1808,14 @@ int main(int argc, char *argv[])
             ac3d.clean();
 
             ac3d.fixOverlapping2SidedSurface();
+            showMemory("fixOverlapping2SidedSurface");
         }
 
         if (combineTexture)
         {
             ac3d.combineTexture();
             ac3d.clean();
+            showMemory("combineTexture");
 
             std::cout << "combineTexture: " << ac3d.getWorldKidCount(0)
                       << " opaque textures "  << ac3d.getWorldKidCount(1)
@@ -1311,7 +1836,11 @@ int main(int argc, char *argv[])
     {
         const std::chrono::time_point<std::chrono::system_clock> end = std::chrono::system_clock::now();
         std::cout << "acclint finished at " << AC3D::getTime(end) << " duration: " << AC3D::getDuration(start, end) << std::endl;
+        profiler.report(std::cout);
     }
 
+    if (show_stats)
+        stats.report(std::cout);
+
     return EXIT_SUCCESS;
 }
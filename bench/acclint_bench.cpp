@@ -0,0 +1,432 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+// Times reading, the checks, clean, flatten, fixOverlapping2SidedSurface,
+// combineTexture and writing a generated model at each of the given object
+// counts. The model is the same for the same settings on every machine so
+// the results can be compared between runs. Each result is written as a
+// JSON object on its own line.
+//
+// Usage: acclint_bench [name=value ...]
+//
+//   objects=100,500,1000   object counts to run, separated by commas
+//   vertices=64            vertices in each object
+//   surfaces=32            surfaces in each object
+//   strip=0                refs in each surface when it's a triangle strip,
+//                          0 for triangles, written as an .acc file
+//   duplicates=0.05        fraction of vertices that are duplicates
+//   doubleSided=0.05       fraction of surfaces that are 2 sided
+//   textures=8             number of textures shared by the objects
+//   depth=2                groups between the world and the objects
+//   seed=1                 random number seed
+//   threads=1              threads used by the checks and fixes
+//   generate=file          only write the model with the first object count
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ac3d.h"
+#include "profiler.h"
+
+namespace {
+
+struct Settings
+{
+    std::vector<size_t> objects{ 100, 500, 1000 };
+    size_t              vertices = 64;
+    size_t              surfaces = 32;
+    size_t              strip = 0;
+    double              duplicates = 0.05;
+    double              double_sided = 0.05;
+    size_t              textures = 8;
+    size_t              depth = 2;
+    uint32_t            seed = 1;
+    unsigned int        threads = 1;
+    std::string         generate;
+};
+
+// Only the output of mt19937 itself is the same everywhere, the standard
+// distributions aren't, so they are done here.
+class Random
+{
+public:
+    explicit Random(uint32_t seed) : m_engine(seed) { }
+
+    // 0 to n - 1
+    size_t below(size_t n)
+    {
+        return static_cast<size_t>(m_engine() % n);
+    }
+
+    // 0 to 1
+    double fraction()
+    {
+        return static_cast<double>(m_engine()) / static_cast<double>(std::mt19937::max());
+    }
+
+private:
+    std::mt19937 m_engine;
+};
+
+class Generator
+{
+public:
+    Generator(const Settings &settings, size_t objects) : m_settings(settings), m_objects(objects), m_random(settings.seed)
+    {
+    }
+
+    void write(std::ostream &out)
+    {
+        const size_t textures = std::max<size_t>(m_settings.textures, 1);
+
+        out << "AC3Db\n";
+        out << "MATERIAL \"opaque\" rgb 1 1 1  amb 0.2 0.2 0.2  emis 0 0 0  spec 0.5 0.5 0.5  shi 10  trans 0\n";
+        out << "MATERIAL \"clear\" rgb 1 1 1  amb 0.2 0.2 0.2  emis 0 0 0  spec 0.5 0.5 0.5  shi 10  trans 0.5\n";
+        out << "OBJECT world\n";
+
+        // each chain of groups has about the same number of objects
+        const size_t chains = m_settings.depth == 0 ? m_objects :
+            std::max<size_t>(static_cast<size_t>(std::sqrt(static_cast<double>(m_objects))), 1);
+
+        out << "kids " << chains << "\n";
+
+        size_t object = 0;
+
+        for (size_t chain = 0; chain < chains; ++chain)
+        {
+            const size_t count = m_objects / chains + (chain < m_objects % chains ? 1 : 0);
+
+            if (m_settings.depth == 0)
+            {
+                writePoly(out, object++, textures);
+                continue;
+            }
+
+            for (size_t level = 0; level < m_settings.depth; ++level)
+            {
+                out << "OBJECT group\n";
+                out << "name \"group" << chain << "_" << level << "\"\n";
+                if (level == 0)
+                    out << "loc " << static_cast<double>(chain) * 0.5 << " 0 0\n";
+                out << "kids " << (level + 1 == m_settings.depth ? count : 1) << "\n";
+            }
+
+            for (size_t i = 0; i < count; ++i)
+                writePoly(out, object++, textures);
+        }
+    }
+
+private:
+    // A height field on a grid so the surfaces aren't degenerate, placed
+    // next to its neighbours so some of them overlap.
+    void writePoly(std::ostream &out, size_t index, size_t textures)
+    {
+        const size_t vertices = std::max<size_t>(m_settings.vertices, 4);
+        const size_t columns = std::max<size_t>(static_cast<size_t>(std::sqrt(static_cast<double>(vertices))), 2);
+        const size_t rows = (vertices + columns - 1) / columns;
+        const size_t grid = std::max<size_t>(static_cast<size_t>(std::sqrt(static_cast<double>(m_objects))), 1);
+        const double x0 = static_cast<double>(index % grid) * 8.0;
+        const double z0 = static_cast<double>(index / grid) * 8.0;
+
+        out << "OBJECT poly\n";
+        out << "name \"poly" << index << "\"\n";
+        out << "texture \"texture" << m_random.below(textures) << ".png\"\n";
+        out << "numvert " << vertices << "\n";
+
+        std::vector<std::string> lines(vertices);
+
+        for (size_t i = 0; i < vertices; ++i)
+        {
+            // a copy of an earlier vertex
+            if (i > 0 && m_random.fraction() < m_settings.duplicates)
+            {
+                lines[i] = lines[m_random.below(i)];
+                out << lines[i];
+                continue;
+            }
+
+            const double x = x0 + static_cast<double>(i % columns) * 10.0 / static_cast<double>(columns);
+            const double z = z0 + static_cast<double>(i / columns) * 10.0 / static_cast<double>(rows);
+            const double y = std::round(m_random.fraction() * 100.0) / 100.0;
+
+            std::ostringstream line;
+
+            line << x << " " << y << " " << z;
+            if (m_settings.strip != 0)
+                line << " 0 1 0";
+            line << "\n";
+
+            lines[i] = line.str();
+            out << lines[i];
+        }
+
+        out << "numsurf " << m_settings.surfaces << "\n";
+
+        const size_t cells = (columns - 1) * (rows - 1);
+
+        for (size_t i = 0; i < m_settings.surfaces; ++i)
+        {
+            const bool double_sided = m_random.fraction() < m_settings.double_sided;
+
+            // every cell is used before any is used again
+            const size_t cell = i % std::max<size_t>(cells, 1);
+            const size_t row = cell / (columns - 1);
+            const size_t column = cell % (columns - 1);
+            std::vector<size_t> refs;
+
+            if (m_settings.strip != 0)
+            {
+                // zigzag between this row and the next one
+                for (size_t j = 0; j < m_settings.strip; ++j)
+                    refs.push_back(std::min((row + j % 2) * columns + (column + j / 2) % columns, vertices - 1));
+            }
+            else
+            {
+                const size_t a = row * columns + column;
+                const size_t b = std::min(a + 1, vertices - 1);
+                const size_t c = std::min(a + columns, vertices - 1);
+
+                refs = { a, b, c };
+            }
+
+            out << "SURF 0x" << std::hex << ((double_sided ? 0x30 : 0x10) | (m_settings.strip != 0 ? 0x04 : 0x00)) << std::dec << "\n";
+            out << "mat " << (m_random.below(8) == 0 ? 1 : 0) << "\n";
+            out << "refs " << refs.size() << "\n";
+
+            for (const size_t ref : refs)
+            {
+                out << ref << " " << static_cast<double>(ref % columns) / static_cast<double>(columns) << " "
+                    << static_cast<double>(ref / columns) / static_cast<double>(rows) << "\n";
+            }
+        }
+
+        out << "kids 0\n";
+    }
+
+    const Settings &m_settings;
+    const size_t    m_objects;
+    Random          m_random;
+};
+
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+};
+
+double milliseconds(const std::function<void()> &function)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    function();
+
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void result(const Settings &settings, size_t objects, const std::string &phase, double ms, size_t calls = 1)
+{
+    std::cout << "{\"bench\":\"acclint\",\"objects\":" << objects
+              << ",\"vertices\":" << settings.vertices
+              << ",\"surfaces\":" << settings.surfaces
+              << ",\"strip\":" << settings.strip
+              << ",\"threads\":" << settings.threads
+              << ",\"phase\":\"" << phase << "\""
+              << ",\"calls\":" << calls
+              << ",\"ms\":" << ms << "}" << std::endl;
+}
+
+bool run(const Settings &settings, size_t objects)
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string extension = settings.strip != 0 ? ".acc" : ".ac";
+    const std::string in_file = (directory / ("acclint_bench" + extension)).string();
+    const std::string out_file = (directory / ("acclint_bench_out" + extension)).string();
+
+    {
+        std::ofstream out(in_file);
+        Generator(settings, objects).write(out);
+    }
+
+    NullBuffer buffer;
+    std::ostream discard(&buffer);
+    AC3D ac3d;
+    bool read = false;
+
+    const auto configure = [&](AC3D &model)
+    {
+        model.outputStream(discard);
+        model.errorStream(discard);
+        model.threads(settings.threads);
+    };
+
+    configure(ac3d);
+
+    result(settings, objects, "read", milliseconds([&]() { read = ac3d.read(in_file); }));
+
+    if (!read || ac3d.errors() != 0)
+    {
+        std::cerr << "Couldn't read " << in_file << std::endl;
+        return false;
+    }
+
+    // The checks are timed while reading it again with the profiler so
+    // the read above isn't slowed down by timing every scope.
+    {
+        Profiler profiler;
+        AC3D profiled;
+
+        configure(profiled);
+        profiled.profiler(&profiler);
+
+        if (!profiled.read(in_file))
+        {
+            std::cerr << "Couldn't read " << in_file << std::endl;
+            return false;
+        }
+
+        for (const auto &total : profiler.totals())
+        {
+            if (total.name.starts_with("check"))
+                result(settings, objects, total.name, total.total, total.calls);
+        }
+    }
+
+    result(settings, objects, "clean", milliseconds([&]() { ac3d.clean(); }));
+    result(settings, objects, "flatten", milliseconds([&]() { ac3d.flatten(); ac3d.clean(); }));
+    result(settings, objects, "fixOverlapping2SidedSurface", milliseconds([&]() { ac3d.fixOverlapping2SidedSurface(); }));
+    result(settings, objects, "combineTexture", milliseconds([&]() { ac3d.combineTexture(); ac3d.clean(); }));
+
+    bool written = false;
+
+    result(settings, objects, "write", milliseconds([&]() { written = ac3d.write(out_file); }));
+
+    std::filesystem::remove(in_file);
+    std::filesystem::remove(out_file);
+
+    if (!written)
+    {
+        std::cerr << "Couldn't write " << out_file << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool parse(int argc, char *argv[], Settings &settings)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const size_t equals = arg.find('=');
+
+        if (equals == std::string::npos)
+        {
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            return false;
+        }
+
+        const std::string name = arg.substr(0, equals);
+        const std::string value = arg.substr(equals + 1);
+
+        if (name == "objects")
+        {
+            settings.objects.clear();
+
+            std::istringstream in(value);
+            std::string count;
+
+            while (std::getline(in, count, ','))
+                settings.objects.push_back(std::strtoul(count.c_str(), nullptr, 10));
+        }
+        else if (name == "vertices")
+            settings.vertices = std::strtoul(value.c_str(), nullptr, 10);
+        else if (name == "surfaces")
+            settings.surfaces = std::strtoul(value.c_str(), nullptr, 10);
+        else if (name == "strip")
+            settings.strip = std::strtoul(value.c_str(), nullptr, 10);
+        else if (name == "duplicates")
+            settings.duplicates = std::strtod(value.c_str(), nullptr);
+        else if (name == "doubleSided")
+            settings.double_sided = std::strtod(value.c_str(), nullptr);
+        else if (name == "textures")
+            settings.textures = std::strtoul(value.c_str(), nullptr, 10);
+        else if (name == "depth")
+            settings.depth = std::strtoul(value.c_str(), nullptr, 10);
+        else if (name == "seed")
+            settings.seed = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+        else if (name == "threads")
+            settings.threads = static_cast<unsigned int>(std::strtoul(value.c_str(), nullptr, 10));
+        else if (name == "generate")
+            settings.generate = value;
+        else
+        {
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            return false;
+        }
+    }
+
+    if (settings.objects.empty() || settings.strip == 1 || settings.strip == 2 || settings.threads == 0)
+    {
+        std::cerr << "Invalid settings" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Settings settings;
+
+    if (!parse(argc, argv, settings))
+        return EXIT_FAILURE;
+
+    if (!settings.generate.empty())
+    {
+        std::ofstream out(settings.generate);
+
+        Generator(settings, settings.objects[0]).write(out);
+
+        return out ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    for (const size_t objects : settings.objects)
+    {
+        if (!run(settings, objects))
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+// Compares reading a file with a warning on almost every line when the
+// warnings are formatted and thrown away with reading it with --quiet
+// --summary where they are only counted.
+//
+// Usage: diagnostics_bench [objects]
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "ac3d.h"
+
+namespace {
+
+// every vertex and ref line has trailing text and every object has
+// duplicate vertices
+void makeFile(const std::string &file, size_t objects)
+{
+    std::ofstream out(file);
+
+    out << "AC3Db\n";
+    out << "MATERIAL \"\" rgb 1 1 1  amb 0.2 0.2 0.2  emis 0 0 0  spec 0.5 0.5 0.5  shi 10  trans 0\n";
+    out << "OBJECT world\n";
+    out << "kids " << objects << "\n";
+
+    for (size_t i = 0; i < objects; ++i)
+    {
+        const double x = static_cast<double>(i);
+
+        out << "OBJECT poly\n";
+        out << "numvert 4\n";
+        out << x << " 0 0 junk\n";
+        out << x + 1 << " 0 0 junk\n";
+        out << x << " 1 0 junk\n";
+        out << x << " 0 0 junk\n";
+        out << "numsurf 1\n";
+        out << "SURF 0x10\n";
+        out << "mat 0\n";
+        out << "refs 3\n";
+        out << "0 0 0 junk\n";
+        out << "1 1 0 junk\n";
+        out << "2 0 1 junk\n";
+        out << "kids 0\n";
+    }
+}
+
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+};
+
+double read(const std::string &file, bool quiet, size_t &warnings)
+{
+    NullBuffer buffer;
+    std::ostream discard(&buffer);
+    AC3D ac3d;
+
+    // compares every object with every other one
+    ac3d.overlapping2SidedSurface(false);
+    ac3d.quiet(quiet);
+    ac3d.summary(quiet);
+    ac3d.errorStream(discard);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    ac3d.read(file);
+
+    const auto end = std::chrono::steady_clock::now();
+
+    warnings = ac3d.warnings();
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t objects = 50000;
+
+    if (argc > 1)
+        objects = std::strtoul(argv[1], nullptr, 10);
+
+    const std::string file = (std::filesystem::temp_directory_path() / "diagnostics_bench.ac").string();
+
+    makeFile(file, objects);
+
+    size_t shown = 0;
+    size_t counted = 0;
+    const double formatted = read(file, false, shown);
+    const double quiet = read(file, true, counted);
+
+    std::filesystem::remove(file);
+
+    std::cout << objects << " objects" << std::endl;
+    std::cout << "                         warnings          ms" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "formatted and discarded" << std::setw(11) << shown << std::setw(12) << formatted << std::endl;
+    std::cout << "--quiet --summary      " << std::setw(11) << counted << std::setw(12) << quiet << std::endl;
+
+    return shown == counted ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,493 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+// Times the geometric tests the overlapping and self intersecting checks
+// are made of, one at a time, on pairs of triangles like the ones found in
+// real models:
+//
+//   disjoint   far apart
+//   adjacent   sharing an edge in the same plane, like the two halves of a quad
+//   coplanar   overlapping in the same plane
+//   crossing   near each other but in different planes
+//   large      adjacent but a long way from the origin
+//
+// How many pairs the float planes decide aren't coplanar is shown and
+// checked against coplanar(). The SIMD bounding box kernels are also
+// timed, testing each triangle against the boxes of all the others, and
+// checked to find the same boxes and every pair boundingBoxesOverlap()
+// finds.
+//
+// Usage: geometry_bench [calls]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ac3d.h"
+#include "boundingboxes.h"
+#include "triangleintersects.hpp"
+
+// a friend of AC3D so it can call the tests directly
+class GeometryBench
+{
+public:
+    using Point3 = AC3D::Point3;
+    using Triangle = AC3D::Triangle;
+    using Plane = AC3D::Plane;
+    using Matrix = AC3D::Matrix;
+
+    using FloatPlane = AC3D::FloatPlane;
+
+    struct Pair
+    {
+        Triangle triangle1;
+        Triangle triangle2;
+        FloatPlane plane1;
+        FloatPlane plane2;
+    };
+
+    static Triangle triangle(const Point3 &p0, const Point3 &p1, const Point3 &p2)
+    {
+        AC3D::Vertex v0;
+        AC3D::Vertex v1;
+        AC3D::Vertex v2;
+
+        v0.vertex = p0;
+        v1.vertex = p1;
+        v2.vertex = p2;
+
+        return Triangle(v0, v1, v2, AC3D::Ref(), AC3D::Ref(), AC3D::Ref());
+    }
+
+    static bool trianglesOverlap(const Pair &pair)
+    {
+        return AC3D::trianglesOverlap(pair.triangle1, pair.triangle2);
+    }
+
+    static bool boundingBoxesOverlap(const Pair &pair)
+    {
+        return AC3D::boundingBoxesOverlap(pair.triangle1, pair.triangle2);
+    }
+
+    static void addBoundingBox(BoundingBoxes &boxes, const Triangle &triangle)
+    {
+        AC3D::addBoundingBox(boxes, triangle);
+    }
+
+    static bool coplanar(const Pair &pair)
+    {
+        return AC3D::coplanar(pair.triangle1, pair.triangle2);
+    }
+
+    static bool notCoplanar(const Pair &pair)
+    {
+        return AC3D::notCoplanar(pair.plane1, pair.plane2);
+    }
+
+    static FloatPlane floatPlane(const Triangle &triangle)
+    {
+        return AC3D::floatPlane(triangle);
+    }
+
+    static bool pointInCoplanarTriangle(const Pair &pair)
+    {
+        return AC3D::pointInCoplanarTriangle(pair.triangle2.vertices[2].vertex, pair.triangle1);
+    }
+
+    static bool closest(const Pair &pair)
+    {
+        return AC3D::closest(pair.triangle1.vertices[0].vertex, pair.triangle1.vertices[1].vertex,
+                             pair.triangle2.vertices[1].vertex, pair.triangle2.vertices[2].vertex) < 1.0;
+    }
+
+    static bool collinear(const Pair &pair)
+    {
+        return AC3D::collinear(pair.triangle1.vertices[0].vertex, pair.triangle1.vertices[1].vertex, pair.triangle2.vertices[2].vertex);
+    }
+
+    static bool degenerate(const Pair &pair)
+    {
+        return AC3D::degenerate(pair.triangle2.vertices[0].vertex, pair.triangle2.vertices[1].vertex, pair.triangle2.vertices[2].vertex);
+    }
+
+    static bool planeEquals(const Pair &pair)
+    {
+        const Plane plane1(pair.triangle1.vertices[0].vertex, pair.triangle1.vertices[1].vertex, pair.triangle1.vertices[2].vertex);
+        const Plane plane2(pair.triangle2.vertices[0].vertex, pair.triangle2.vertices[1].vertex, pair.triangle2.vertices[2].vertex);
+
+        return plane1.equals(plane2);
+    }
+
+    static bool triangleIntersects(const Pair &pair)
+    {
+        Point3 p1{ 0, 0, 0 };
+        Point3 p2{ 0, 0, 0 };
+        bool b = false;
+
+        return threeyd::moeller::TriangleIntersects<Point3>::triangle(
+            pair.triangle1.vertices[0].vertex, pair.triangle1.vertices[1].vertex, pair.triangle1.vertices[2].vertex,
+            pair.triangle2.vertices[0].vertex, pair.triangle2.vertices[1].vertex, pair.triangle2.vertices[2].vertex,
+            p1, p2, b);
+    }
+};
+
+namespace {
+
+using Point3 = GeometryBench::Point3;
+using Pair = GeometryBench::Pair;
+using Matrix = GeometryBench::Matrix;
+
+// keeps the compiler from optimizing away the work being timed
+volatile size_t sink = 0;
+
+// Only the output of mt19937 itself is the same everywhere, the standard
+// distributions aren't.
+class Random
+{
+public:
+    explicit Random(uint32_t seed) : m_engine(seed) { }
+
+    // -1 to 1
+    double signedFraction()
+    {
+        return static_cast<double>(m_engine()) / static_cast<double>(std::mt19937::max()) * 2.0 - 1.0;
+    }
+
+    Point3 point(double scale)
+    {
+        return Point3{ signedFraction() * scale, signedFraction() * scale, signedFraction() * scale };
+    }
+
+private:
+    std::mt19937 m_engine;
+};
+
+enum class Inputs { disjoint, adjacent, coplanar, crossing, large };
+
+const char *inputsName(Inputs inputs)
+{
+    switch (inputs)
+    {
+    case Inputs::disjoint: return "disjoint";
+    case Inputs::adjacent: return "adjacent";
+    case Inputs::coplanar: return "coplanar";
+    case Inputs::crossing: return "crossing";
+    case Inputs::large: return "large";
+    }
+
+    return "";
+}
+
+std::vector<Pair> makePairs(Inputs inputs, size_t count)
+{
+    Random random(12345);
+    std::vector<Pair> pairs;
+
+    pairs.reserve(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Point3 origin = random.point(100.0) + (inputs == Inputs::large ? Point3{ 1.0e6, 2.0e5, 1.0e6 } : Point3{ 0, 0, 0 });
+
+        // two edges of a triangle in a random plane
+        const Point3 u = random.point(1.0);
+        Point3 v = random.point(1.0);
+
+        const Point3 a = origin;
+        const Point3 b = origin + u;
+        const Point3 c = origin + v;
+
+        switch (inputs)
+        {
+        case Inputs::disjoint:
+            pairs.push_back({ GeometryBench::triangle(a, b, c),
+                              GeometryBench::triangle(a + Point3{ 10, 0, 0 }, b + Point3{ 10, 0, 0 }, c + Point3{ 10, 0, 0 }), {}, {} });
+            break;
+        case Inputs::adjacent:
+        case Inputs::large:
+            // the other half of the parallelogram
+            pairs.push_back({ GeometryBench::triangle(a, b, c), GeometryBench::triangle(c, b, b + v), {}, {} });
+            break;
+        case Inputs::coplanar:
+            // moved a little within the plane
+            pairs.push_back({ GeometryBench::triangle(a, b, c),
+                              GeometryBench::triangle(a + u * 0.25 + v * 0.25, b + u * 0.25 + v * 0.25, c + u * 0.25 + v * 0.25), {}, {} });
+            break;
+        case Inputs::crossing:
+            pairs.push_back({ GeometryBench::triangle(a, b, c),
+                              GeometryBench::triangle(a + random.point(0.5), b + random.point(0.5), c + random.point(0.5)), {}, {} });
+            break;
+        }
+
+        pairs.back().plane1 = GeometryBench::floatPlane(pairs.back().triangle1);
+        pairs.back().plane2 = GeometryBench::floatPlane(pairs.back().triangle2);
+    }
+
+    return pairs;
+}
+
+// nanoseconds per call
+template <typename Function>
+double time(const std::vector<Pair> &pairs, size_t calls, const Function &function)
+{
+    size_t found = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < calls; ++i)
+        found += function(pairs[i % pairs.size()]) ? 1 : 0;
+
+    const auto end = std::chrono::steady_clock::now();
+
+    sink = sink + found;
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(calls);
+}
+
+struct Kernel
+{
+    const char *name;
+    bool (*function)(const Pair &pair);
+};
+
+constexpr Kernel kernels[] =
+{
+    { "trianglesOverlap",                 GeometryBench::trianglesOverlap },
+    { "boundingBoxesOverlap",             GeometryBench::boundingBoxesOverlap },
+    { "coplanar",                         GeometryBench::coplanar },
+    { "notCoplanar (float)",              GeometryBench::notCoplanar },
+    { "pointInCoplanarTriangle",          GeometryBench::pointInCoplanarTriangle },
+    { "closest",                          GeometryBench::closest },
+    { "collinear",                        GeometryBench::collinear },
+    { "degenerate",                       GeometryBench::degenerate },
+    { "Plane::equals",                    GeometryBench::planeEquals },
+    { "TriangleIntersects::triangle",     GeometryBench::triangleIntersects },
+};
+
+constexpr Inputs all_inputs[] = { Inputs::disjoint, Inputs::adjacent, Inputs::coplanar, Inputs::crossing, Inputs::large };
+
+void runMatrix(size_t calls)
+{
+    Random random(12345);
+    std::vector<Matrix> matrices(1024);
+    std::vector<Point3> points(1024);
+
+    for (size_t i = 0; i < matrices.size(); ++i)
+    {
+        matrices[i].setLocation(random.point(100.0));
+        points[i] = random.point(100.0);
+    }
+
+    Matrix product;
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < calls; ++i)
+        product = product.multiply(matrices[i % matrices.size()]);
+
+    auto end = std::chrono::steady_clock::now();
+
+    const double multiply = std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(calls);
+
+    Point3 sum{ 0, 0, 0 };
+
+    start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < calls; ++i)
+    {
+        Point3 point = points[i % points.size()];
+        matrices[(i / points.size()) % matrices.size()].transformPoint(point);
+        sum = sum + point;
+    }
+
+    end = std::chrono::steady_clock::now();
+
+    const double transform = std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(calls);
+
+    sink = sink + static_cast<size_t>(product[3][0] != 0) + static_cast<size_t>(sum.x() != 0);
+
+    std::cout << std::left << std::setw(32) << "Matrix::multiply" << std::right << std::setw(11) << multiply << std::endl;
+    std::cout << std::left << std::setw(32) << "Matrix::transformPoint" << std::right << std::setw(11) << transform << std::endl;
+}
+
+// The percent of pairs the float planes decide or a negative number
+// when they find a pair not coplanar that coplanar() finds coplanar.
+double floatDecided(const std::vector<Pair> &pairs)
+{
+    size_t decided = 0;
+
+    for (const auto &pair : pairs)
+    {
+        if (GeometryBench::notCoplanar(pair))
+        {
+            if (GeometryBench::coplanar(pair))
+                return -1.0;
+
+            ++decided;
+        }
+    }
+
+    return 100.0 * static_cast<double>(decided) / static_cast<double>(pairs.size());
+}
+
+constexpr BoundingBoxes::Kernel box_kernels[] = { BoundingBoxes::Kernel::scalar, BoundingBoxes::Kernel::sse2, BoundingBoxes::Kernel::avx2 };
+
+// nanoseconds per box tested, or a negative number when a kernel finds
+// different boxes than boundingBoxesOverlap()
+double timeBoxes(const std::vector<Pair> &pairs, size_t calls)
+{
+    BoundingBoxes boxes1;
+    BoundingBoxes boxes2;
+
+    for (const auto &pair : pairs)
+    {
+        GeometryBench::addBoundingBox(boxes1, pair.triangle1);
+        GeometryBench::addBoundingBox(boxes2, pair.triangle2);
+    }
+
+    std::vector<size_t> indexes;
+
+    for (size_t i = 0; i < pairs.size(); ++i)
+    {
+        indexes.clear();
+        boxes2.overlapping(boxes1, i, indexes);
+
+        size_t next = 0;
+
+        for (size_t j = 0; j < pairs.size(); ++j)
+        {
+            const bool found = next < indexes.size() && indexes[next] == j;
+
+            if (found)
+                ++next;
+            else if (GeometryBench::boundingBoxesOverlap({ pairs[i].triangle1, pairs[j].triangle2, {}, {} }))
+                return -1.0;
+        }
+    }
+
+    const size_t tests = calls / pairs.size() + 1;
+    size_t found = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < tests; ++i)
+    {
+        indexes.clear();
+        boxes2.overlapping(boxes1, i % pairs.size(), indexes);
+        found += indexes.size();
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+
+    sink = sink + found;
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(tests * pairs.size());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t calls = 2000000;
+
+    if (argc > 1)
+        calls = std::strtoul(argv[1], nullptr, 10);
+
+    if (calls == 0)
+        calls = 1;
+
+    std::vector<std::vector<Pair>> pairs;
+
+    for (const Inputs inputs : all_inputs)
+        pairs.push_back(makePairs(inputs, 4096));
+
+    std::cout << calls << " calls, ns per call" << std::endl;
+    std::cout << std::left << std::setw(32) << "kernel" << std::right;
+    for (const Inputs inputs : all_inputs)
+        std::cout << std::setw(11) << inputsName(inputs);
+    std::cout << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    for (const auto &kernel : kernels)
+    {
+        std::cout << std::left << std::setw(32) << kernel.name << std::right;
+
+        for (const auto &inputs : pairs)
+            std::cout << std::setw(11) << time(inputs, calls, kernel.function);
+
+        std::cout << std::endl;
+    }
+
+    runMatrix(calls);
+
+    bool failed = false;
+
+    std::cout << std::left << std::setw(32) << "notCoplanar decided %" << std::right;
+
+    for (const auto &inputs : pairs)
+    {
+        const double decided = floatDecided(inputs);
+
+        if (decided < 0)
+        {
+            std::cout << std::setw(11) << "WRONG";
+            failed = true;
+        }
+        else
+            std::cout << std::setw(11) << decided;
+    }
+
+    std::cout << std::endl;
+
+    const BoundingBoxes::Kernel fastest = BoundingBoxes::kernel();
+
+    std::cout << std::endl << "ns per box" << std::endl;
+
+    for (const auto kernel : box_kernels)
+    {
+        if (!BoundingBoxes::kernel(kernel))
+            continue;
+
+        std::cout << std::left << std::setw(32) << (std::string("BoundingBoxes ") + BoundingBoxes::kernelName(kernel)) << std::right;
+
+        for (const auto &inputs : pairs)
+        {
+            const double ns = timeBoxes(inputs, calls);
+
+            if (ns < 0)
+            {
+                std::cout << std::setw(11) << "MISMATCH";
+                failed = true;
+            }
+            else
+                std::cout << std::setw(11) << ns;
+        }
+
+        std::cout << std::endl;
+    }
+
+    BoundingBoxes::kernel(fastest);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+// Compares the thread pool parallelFor with the OpenMP parallel for that
+// cleanSurfaces used to use. Each item is an object whose vertices are
+// searched for duplicates the way cleanVertices does, and each run is
+// repeated like clean() is called repeatedly from acclint.
+//
+// Usage: threadpool_bench [max threads]
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <omp.h>
+
+#include "threadpool.h"
+
+namespace {
+
+using Vertex = std::array<double, 3>;
+using Object = std::vector<Vertex>;
+
+std::vector<Object> makeObjects(size_t objects, size_t vertices)
+{
+    std::mt19937 random(12345);
+    std::uniform_int_distribution<int> coordinate(0, 100);
+    std::vector<Object> result(objects);
+
+    for (auto &object : result)
+    {
+        object.resize(vertices);
+
+        for (auto &vertex : object)
+            vertex = { coordinate(random) * 0.5, coordinate(random) * 0.5, coordinate(random) * 0.5 };
+    }
+
+    return result;
+}
+
+bool duplicates(const Object &object)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < object.size(); ++i)
+    {
+        for (size_t j = i + 1; j < object.size(); ++j)
+        {
+            if (object[i] == object[j])
+                count++;
+        }
+    }
+
+    return count != 0;
+}
+
+// keeps the compiler from optimizing away the work being timed
+volatile bool sink = false;
+
+template <typename Function>
+double time(size_t repeat, const Function &function)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < repeat; ++i)
+        sink = function();
+
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void run(const std::string &name, size_t objects, size_t vertices, size_t repeat, unsigned int max_threads)
+{
+    const std::vector<Object> model = makeObjects(objects, vertices);
+    const int size = static_cast<int>(model.size());
+
+    std::cout << name << ": " << objects << " objects with " << vertices << " vertices, "
+              << repeat << " runs" << std::endl;
+    std::cout << "threads      openmp ms  threadpool ms" << std::endl;
+
+    for (unsigned int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        const double openmp = time(repeat, [&model, size, threads]
+        {
+            bool found = false;
+
+            #pragma omp parallel for reduction(|:found) num_threads(threads)
+            for (int i = 0; i < size; i++)
+            {
+                found |= duplicates(model[i]);
+            }
+
+            return found;
+        });
+
+        ThreadPool pool(threads);
+
+        const double threadpool = time(repeat, [&model, &pool]
+        {
+            std::atomic<bool> found = false;
+
+            pool.parallelFor(0, model.size(), [&model, &found](size_t i)
+            {
+                if (duplicates(model[i]))
+                    found = true;
+            });
+
+            return found.load();
+        });
+
+        std::cout << std::setw(7) << threads
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(15) << openmp
+                  << std::setw(15) << threadpool << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    unsigned int max_threads = std::thread::hardware_concurrency();
+
+    if (argc > 1)
+        max_threads = static_cast<unsigned int>(std::strtoul(argv[1], nullptr, 10));
+
+    if (max_threads < 1)
+        max_threads = 1;
+
+    run("many small objects", 100000, 16, 20, max_threads);
+    run("few huge objects", 8, 4000, 5, max_threads);
+    run("medium objects", 2000, 64, 20, max_threads);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,323 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#include "boundingboxes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+// SSE2 is always there on x86-64, AVX2 is checked for when running
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BOUNDINGBOXES_X86
+#define BOUNDINGBOXES_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_M_X64) && defined(_MSC_VER)
+#define BOUNDINGBOXES_X86
+#define BOUNDINGBOXES_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace {
+
+// the arrays of the boxes being tested against and the box tested
+struct Boxes
+{
+    const float *min_x;
+    const float *min_y;
+    const float *min_z;
+    const float *max_x;
+    const float *max_y;
+    const float *max_z;
+    size_t       count; // a multiple of 8
+};
+
+struct Box
+{
+    float min_x;
+    float min_y;
+    float min_z;
+    float max_x;
+    float max_y;
+    float max_z;
+};
+
+using Function = void (*)(const Boxes &boxes, const Box &box, std::vector<size_t> &indexes);
+
+void overlappingScalar(const Boxes &boxes, const Box &box, std::vector<size_t> &indexes)
+{
+    for (size_t i = 0; i < boxes.count; ++i)
+    {
+        if (box.min_x <= boxes.max_x[i] && boxes.min_x[i] <= box.max_x &&
+            box.min_y <= boxes.max_y[i] && boxes.min_y[i] <= box.max_y &&
+            box.min_z <= boxes.max_z[i] && boxes.min_z[i] <= box.max_z)
+        {
+            indexes.push_back(i);
+        }
+    }
+}
+
+#if defined(BOUNDINGBOXES_X86)
+
+// adds the index of each bit set in mask
+void addIndexes(unsigned int mask, size_t first, std::vector<size_t> &indexes)
+{
+    while (mask != 0)
+    {
+        size_t bit = 0;
+
+        while ((mask & (1u << bit)) == 0)
+            ++bit;
+
+        indexes.push_back(first + bit);
+        mask &= mask - 1;
+    }
+}
+
+void overlappingSSE2(const Boxes &boxes, const Box &box, std::vector<size_t> &indexes)
+{
+    const __m128 min_x = _mm_set1_ps(box.min_x);
+    const __m128 min_y = _mm_set1_ps(box.min_y);
+    const __m128 min_z = _mm_set1_ps(box.min_z);
+    const __m128 max_x = _mm_set1_ps(box.max_x);
+    const __m128 max_y = _mm_set1_ps(box.max_y);
+    const __m128 max_z = _mm_set1_ps(box.max_z);
+
+    for (size_t i = 0; i < boxes.count; i += 4)
+    {
+        __m128 overlap = _mm_and_ps(_mm_cmple_ps(min_x, _mm_loadu_ps(boxes.max_x + i)),
+                                    _mm_cmple_ps(_mm_loadu_ps(boxes.min_x + i), max_x));
+        overlap = _mm_and_ps(overlap, _mm_cmple_ps(min_y, _mm_loadu_ps(boxes.max_y + i)));
+        overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_loadu_ps(boxes.min_y + i), max_y));
+        overlap = _mm_and_ps(overlap, _mm_cmple_ps(min_z, _mm_loadu_ps(boxes.max_z + i)));
+        overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_loadu_ps(boxes.min_z + i), max_z));
+
+        addIndexes(static_cast<unsigned int>(_mm_movemask_ps(overlap)), i, indexes);
+    }
+}
+
+BOUNDINGBOXES_AVX2
+void overlappingAVX2(const Boxes &boxes, const Box &box, std::vector<size_t> &indexes)
+{
+    const __m256 min_x = _mm256_set1_ps(box.min_x);
+    const __m256 min_y = _mm256_set1_ps(box.min_y);
+    const __m256 min_z = _mm256_set1_ps(box.min_z);
+    const __m256 max_x = _mm256_set1_ps(box.max_x);
+    const __m256 max_y = _mm256_set1_ps(box.max_y);
+    const __m256 max_z = _mm256_set1_ps(box.max_z);
+
+    for (size_t i = 0; i < boxes.count; i += 8)
+    {
+        __m256 overlap = _mm256_and_ps(_mm256_cmp_ps(min_x, _mm256_loadu_ps(boxes.max_x + i), _CMP_LE_OQ),
+                                       _mm256_cmp_ps(_mm256_loadu_ps(boxes.min_x + i), max_x, _CMP_LE_OQ));
+        overlap = _mm256_and_ps(overlap, _mm256_cmp_ps(min_y, _mm256_loadu_ps(boxes.max_y + i), _CMP_LE_OQ));
+        overlap = _mm256_and_ps(overlap, _mm256_cmp_ps(_mm256_loadu_ps(boxes.min_y + i), max_y, _CMP_LE_OQ));
+        overlap = _mm256_and_ps(overlap, _mm256_cmp_ps(min_z, _mm256_loadu_ps(boxes.max_z + i), _CMP_LE_OQ));
+        overlap = _mm256_and_ps(overlap, _mm256_cmp_ps(_mm256_loadu_ps(boxes.min_z + i), max_z, _CMP_LE_OQ));
+
+        addIndexes(static_cast<unsigned int>(_mm256_movemask_ps(overlap)), i, indexes);
+    }
+}
+
+bool hasAVX2()
+{
+#if defined(_MSC_VER)
+    int info[4] = {};
+
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    // the OS must save the AVX registers
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+BoundingBoxes::Kernel best()
+{
+#if defined(BOUNDINGBOXES_X86)
+    if (hasAVX2())
+        return BoundingBoxes::Kernel::avx2;
+
+    return BoundingBoxes::Kernel::sse2;
+#else
+    return BoundingBoxes::Kernel::scalar;
+#endif
+}
+
+std::atomic<BoundingBoxes::Kernel> &selected()
+{
+    static std::atomic<BoundingBoxes::Kernel> kernel = best();
+
+    return kernel;
+}
+
+Function function(BoundingBoxes::Kernel kernel)
+{
+    switch (kernel)
+    {
+#if defined(BOUNDINGBOXES_X86)
+    case BoundingBoxes::Kernel::avx2: return overlappingAVX2;
+    case BoundingBoxes::Kernel::sse2: return overlappingSSE2;
+#endif
+    default: return overlappingScalar;
+    }
+}
+
+// the nearest floats at or below and at or above a double
+float floatBelow(double value)
+{
+    float rounded = static_cast<float>(value);
+
+    if (static_cast<double>(rounded) > value)
+        rounded = std::nextafter(rounded, -std::numeric_limits<float>::infinity());
+
+    return rounded;
+}
+
+float floatAbove(double value)
+{
+    float rounded = static_cast<float>(value);
+
+    if (static_cast<double>(rounded) < value)
+        rounded = std::nextafter(rounded, std::numeric_limits<float>::infinity());
+
+    return rounded;
+}
+
+} // namespace
+
+void BoundingBoxes::add(double min_x, double min_y, double min_z, double max_x, double max_y, double max_z)
+{
+    if (m_size == m_min_x.size())
+    {
+        // an empty box, the minimum is more than anything's maximum
+        const size_t padded = m_size + block;
+        const float infinity = std::numeric_limits<float>::infinity();
+
+        m_min_x.resize(padded, infinity);
+        m_min_y.resize(padded, infinity);
+        m_min_z.resize(padded, infinity);
+        m_max_x.resize(padded, -infinity);
+        m_max_y.resize(padded, -infinity);
+        m_max_z.resize(padded, -infinity);
+    }
+
+    m_min_x[m_size] = floatBelow(min_x);
+    m_min_y[m_size] = floatBelow(min_y);
+    m_min_z[m_size] = floatBelow(min_z);
+    m_max_x[m_size] = floatAbove(max_x);
+    m_max_y[m_size] = floatAbove(max_y);
+    m_max_z[m_size] = floatAbove(max_z);
+
+    if (m_size == 0)
+    {
+        m_bounds_min[0] = m_min_x[0];
+        m_bounds_min[1] = m_min_y[0];
+        m_bounds_min[2] = m_min_z[0];
+        m_bounds_max[0] = m_max_x[0];
+        m_bounds_max[1] = m_max_y[0];
+        m_bounds_max[2] = m_max_z[0];
+    }
+    else
+    {
+        m_bounds_min[0] = std::min(m_bounds_min[0], m_min_x[m_size]);
+        m_bounds_min[1] = std::min(m_bounds_min[1], m_min_y[m_size]);
+        m_bounds_min[2] = std::min(m_bounds_min[2], m_min_z[m_size]);
+        m_bounds_max[0] = std::max(m_bounds_max[0], m_max_x[m_size]);
+        m_bounds_max[1] = std::max(m_bounds_max[1], m_max_y[m_size]);
+        m_bounds_max[2] = std::max(m_bounds_max[2], m_max_z[m_size]);
+    }
+
+    ++m_size;
+}
+
+bool BoundingBoxes::boundsOverlap(const BoundingBoxes &boxes) const
+{
+    if (m_size == 0 || boxes.m_size == 0)
+        return false;
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        if (!(m_bounds_min[i] <= boxes.m_bounds_max[i] && boxes.m_bounds_min[i] <= m_bounds_max[i]))
+            return false;
+    }
+
+    return true;
+}
+
+size_t BoundingBoxes::memory() const
+{
+    return (m_min_x.capacity() + m_min_y.capacity() + m_min_z.capacity() +
+            m_max_x.capacity() + m_max_y.capacity() + m_max_z.capacity()) * sizeof(float);
+}
+
+void BoundingBoxes::overlapping(const BoundingBoxes &boxes, size_t index, std::vector<size_t> &indexes) const
+{
+    const Boxes others{ m_min_x.data(), m_min_y.data(), m_min_z.data(),
+                        m_max_x.data(), m_max_y.data(), m_max_z.data(), m_min_x.size() };
+    const Box box{ boxes.m_min_x[index], boxes.m_min_y[index], boxes.m_min_z[index],
+                   boxes.m_max_x[index], boxes.m_max_y[index], boxes.m_max_z[index] };
+
+    function(selected())(others, box, indexes);
+}
+
+BoundingBoxes::Kernel BoundingBoxes::kernel()
+{
+    return selected();
+}
+
+const char *BoundingBoxes::kernelName(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Kernel::scalar: return "scalar";
+    case Kernel::sse2: return "sse2";
+    case Kernel::avx2: return "avx2";
+    }
+
+    return "";
+}
+
+bool BoundingBoxes::kernel(Kernel kernel)
+{
+    const Kernel fastest = best();
+
+    if (kernel == Kernel::avx2 && fastest != Kernel::avx2)
+        return false;
+
+    if (kernel == Kernel::sse2 && fastest == Kernel::scalar)
+        return false;
+
+    selected() = kernel;
+
+    return true;
+}
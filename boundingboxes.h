@@ -0,0 +1,75 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#ifndef BOUNDINGBOXES_H
+#define BOUNDINGBOXES_H
+
+#include <cstddef>
+#include <vector>
+
+// The bounding boxes of the triangles of an object as floats, each coordinate
+// in its own array so one box can be tested against 4 or 8 others at once
+// with SSE2 or AVX2. The coordinates are rounded outwards so a box is never
+// smaller than the doubles it was made from and a pair that isn't found
+// overlapping here doesn't overlap in double precision either.
+class BoundingBoxes
+{
+public:
+    enum class Kernel { scalar, sse2, avx2 };
+
+    void add(double min_x, double min_y, double min_z, double max_x, double max_y, double max_z);
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    // if the box around all these boxes overlaps the one around boxes
+    bool boundsOverlap(const BoundingBoxes &boxes) const;
+
+    // the bytes used by the arrays
+    size_t memory() const;
+
+    // Appends the indexes of these boxes that overlap box index of boxes
+    // to indexes, in increasing order.
+    void overlapping(const BoundingBoxes &boxes, size_t index, std::vector<size_t> &indexes) const;
+
+    // the fastest kernel this processor has, used unless another is chosen
+    static Kernel kernel();
+    static const char *kernelName(Kernel kernel);
+    // returns false if this processor doesn't have it
+    static bool kernel(Kernel kernel);
+
+private:
+    // a multiple of 8 boxes are stored, the ones after m_size never overlap
+    static constexpr size_t block = 8;
+
+    size_t              m_size = 0;
+    float               m_bounds_min[3] = { 0, 0, 0 };
+    float               m_bounds_max[3] = { 0, 0, 0 };
+    std::vector<float>  m_min_x;
+    std::vector<float>  m_min_y;
+    std::vector<float>  m_min_z;
+    std::vector<float>  m_max_x;
+    std::vector<float>  m_max_y;
+    std::vector<float>  m_max_z;
+};
+
+#endif
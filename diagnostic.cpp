@@ -0,0 +1,282 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#include "diagnostic.h"
+
+#include "config.h"
+
+namespace {
+
+// The length of the UTF-8 sequence starting at text[index], or 0 if it
+// isn't valid with invalid set to how many bytes (at least 1) began it.
+// Those are replaced by a single U+FFFD.
+size_t utf8Sequence(std::string_view text, size_t index, size_t &invalid)
+{
+    const unsigned char first = static_cast<unsigned char>(text[index]);
+    size_t length = 0;
+    unsigned char low = 0x80; // the range of the second byte
+    unsigned char high = 0xbf;
+
+    if (first >= 0xc2 && first <= 0xdf)
+        length = 2;
+    else if (first >= 0xe0 && first <= 0xef)
+    {
+        length = 3;
+        if (first == 0xe0)
+            low = 0xa0;      // overlong
+        else if (first == 0xed)
+            high = 0x9f;     // surrogates
+    }
+    else if (first >= 0xf0 && first <= 0xf4)
+    {
+        length = 4;
+        if (first == 0xf0)
+            low = 0x90;      // overlong
+        else if (first == 0xf4)
+            high = 0x8f;     // above U+10FFFF
+    }
+
+    invalid = 1;
+
+    if (length == 0)
+        return 0;
+
+    for (size_t i = 1; i < length; ++i)
+    {
+        if (index + i >= text.size())
+            return 0;
+
+        const unsigned char c = static_cast<unsigned char>(text[index + i]);
+
+        if (c < (i == 1 ? low : 0x80) || c > (i == 1 ? high : 0xbf))
+            return 0;
+
+        invalid = i + 1;
+    }
+
+    return length;
+}
+
+} // namespace
+
+void writeJsonString(Writer &out, std::string_view text)
+{
+    out << '"';
+
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        const char c = text[i];
+
+        // JSON must be valid UTF-8 so anything else in a file is replaced
+        if (static_cast<unsigned char>(c) >= 0x80)
+        {
+            size_t invalid = 0;
+            const size_t length = utf8Sequence(text, i, invalid);
+
+            if (length != 0)
+                out << text.substr(i, length);
+            else
+                out << "\\ufffd";
+
+            i += (length != 0 ? length : invalid) - 1;
+            continue;
+        }
+
+        switch (c)
+        {
+        case '"':
+            out << "\\\"";
+            break;
+        case '\\':
+            out << "\\\\";
+            break;
+        case '\n':
+            out << "\\n";
+            break;
+        case '\r':
+            out << "\\r";
+            break;
+        case '\t':
+            out << "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out << "\\u00";
+                if (static_cast<unsigned char>(c) < 0x10)
+                    out << '0';
+                out.hex(static_cast<unsigned char>(c));
+            }
+            else
+                out << c;
+            break;
+        }
+    }
+
+    out << '"';
+}
+
+namespace {
+
+void writeJsonLocation(Writer &out, const Diagnostic::Location &location)
+{
+    out << "\"line\":" << location.line;
+    if (location.column != 0)
+        out << ",\"column\":" << location.column;
+    out << ",\"message\":";
+    writeJsonString(out, location.message);
+    if (!location.source.empty())
+    {
+        out << ",\"source\":";
+        writeJsonString(out, location.source);
+    }
+}
+
+// related locations also have a message
+void writeSarifLocation(Writer &out, const std::string &file, const Diagnostic::Location &location, bool message)
+{
+    out << "{\"physicalLocation\":{\"artifactLocation\":{\"uri\":";
+    writeJsonString(out, file);
+    out << "}";
+    if (location.line != 0)
+    {
+        out << ",\"region\":{\"startLine\":" << location.line;
+        if (location.column != 0)
+            out << ",\"startColumn\":" << location.column;
+        if (!location.source.empty())
+        {
+            out << ",\"snippet\":{\"text\":";
+            writeJsonString(out, location.source);
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "}";
+    if (message)
+    {
+        out << ",\"message\":{\"text\":";
+        writeJsonString(out, location.message);
+        out << "}";
+    }
+    out << "}";
+}
+
+} // namespace
+
+void writeJsonLines(Writer &out, const Diagnostic &diagnostic)
+{
+    out << "{\"file\":";
+    writeJsonString(out, diagnostic.file);
+    out << ",\"severity\":";
+    writeJsonString(out, diagnostic.severity);
+    if (!diagnostic.check.empty())
+    {
+        out << ",\"check\":";
+        writeJsonString(out, diagnostic.check);
+    }
+    out << ',';
+    writeJsonLocation(out, diagnostic.location);
+    if (!diagnostic.notes.empty())
+    {
+        out << ",\"notes\":[";
+        for (size_t i = 0; i < diagnostic.notes.size(); ++i)
+        {
+            if (i != 0)
+                out << ',';
+            out << '{';
+            writeJsonLocation(out, diagnostic.notes[i]);
+            out << '}';
+        }
+        out << ']';
+    }
+    out << "}\n";
+}
+
+void writeSarifResult(Writer &out, const Diagnostic &diagnostic)
+{
+    out << '{';
+    if (!diagnostic.check.empty())
+    {
+        out << "\"ruleId\":";
+        writeJsonString(out, diagnostic.check);
+        out << ',';
+    }
+    out << "\"level\":";
+    writeJsonString(out, diagnostic.severity);
+    out << ",\"message\":{\"text\":";
+    writeJsonString(out, diagnostic.location.message);
+    out << "},\"locations\":[";
+    writeSarifLocation(out, diagnostic.file, diagnostic.location, false);
+    out << ']';
+    if (!diagnostic.notes.empty())
+    {
+        out << ",\"relatedLocations\":[";
+        for (size_t i = 0; i < diagnostic.notes.size(); ++i)
+        {
+            if (i != 0)
+                out << ',';
+            writeSarifLocation(out, diagnostic.file, diagnostic.notes[i], true);
+        }
+        out << ']';
+    }
+    out << "}\n";
+}
+
+void writeSarif(Writer &out, const std::vector<std::string> &rules, std::string_view results)
+{
+    const std::string version = std::to_string(acclint_VERSION_MAJOR) + "." + std::to_string(acclint_VERSION_MINOR);
+
+    out << "{\"version\":\"2.1.0\","
+           "\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\","
+           "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"acclint\",\"version\":";
+    writeJsonString(out, version);
+    out << ",\"informationUri\":\"https://github.com/IOBYTE/acclint\",\"rules\":[";
+    for (size_t i = 0; i < rules.size(); ++i)
+    {
+        if (i != 0)
+            out << ',';
+        out << "{\"id\":";
+        writeJsonString(out, rules[i]);
+        out << '}';
+    }
+    out << "]}},\"results\":[";
+
+    bool first = true;
+
+    while (!results.empty())
+    {
+        const size_t end = results.find('\n');
+        const std::string_view result = results.substr(0, end);
+
+        if (!result.empty())
+        {
+            if (!first)
+                out << ',';
+            out << '\n' << result;
+            first = false;
+        }
+
+        if (end == std::string_view::npos)
+            break;
+        results.remove_prefix(end + 1);
+    }
+
+    out << "\n]}]}\n";
+}
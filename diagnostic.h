@@ -0,0 +1,66 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#ifndef DIAGNOSTIC_H
+#define DIAGNOSTIC_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "writer.h"
+
+// How warnings and errors are shown: as text for people or as JSON Lines
+// or SARIF for tools.
+enum class DiagnosticFormat { text, jsonl, sarif };
+
+// A warning or error with everything that the text output shows, kept
+// separate so it can be written in a machine readable format.
+struct Diagnostic
+{
+    struct Location
+    {
+        size_t      line = 0;
+        size_t      column = 0; // 0 when unknown
+        std::string message;
+        std::string source;     // only with source excerpts
+    };
+
+    std::string           file;
+    std::string           severity; // "warning", "error" or "note"
+    std::string           check;    // the -W name, empty when it can't be turned off
+    Location              location;
+    std::vector<Location> notes;    // related locations like the first instance
+};
+
+// A JSON string with the quotes. Invalid UTF-8 is replaced by U+FFFD.
+void writeJsonString(Writer &out, std::string_view text);
+
+// One JSON object on a single line.
+void writeJsonLines(Writer &out, const Diagnostic &diagnostic);
+
+// A SARIF result object on a single line.
+void writeSarifResult(Writer &out, const Diagnostic &diagnostic);
+
+// A SARIF log with one run containing the results, which are the lines
+// written by writeSarifResult().
+void writeSarif(Writer &out, const std::vector<std::string> &rules, std::string_view results);
+
+#endif
@@ -0,0 +1,195 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#include "diagnosticbuf.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#ifdef _WIN32
+#include <io.h>
+#define fdopen _fdopen
+#define fileno _fileno
+#define isatty _isatty
+#else
+#include <unistd.h>
+#endif
+
+DiagnosticBuf::DiagnosticBuf() : m_buffer(64 * 1024)
+{
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+}
+
+DiagnosticBuf::~DiagnosticBuf()
+{
+    flush();
+
+    if (m_close)
+        std::fclose(m_file);
+}
+
+bool DiagnosticBuf::open(const std::string &file)
+{
+    std::FILE *stream = std::fopen(file.c_str(), "wb");
+
+    if (stream == nullptr)
+        return false;
+
+    flush();
+
+    if (m_close)
+        std::fclose(m_file);
+
+    m_file = stream;
+    m_close = true;
+
+    return true;
+}
+
+bool DiagnosticBuf::open(int fd)
+{
+    std::FILE *stream = fdopen(fd, "wb");
+
+    if (stream == nullptr)
+        return false;
+
+    flush();
+
+    if (m_close)
+        std::fclose(m_file);
+
+    m_file = stream;
+    m_close = true;
+
+    return true;
+}
+
+bool DiagnosticBuf::terminal() const
+{
+    return isatty(fileno(m_file)) != 0;
+}
+
+bool DiagnosticBuf::flush()
+{
+    const size_t size = static_cast<size_t>(pptr() - pbase());
+
+    // everything already written was flushed with it
+    if (size == 0)
+        return true;
+
+    bool ok = std::fwrite(pbase(), 1, size, m_file) == size;
+
+    ok = std::fflush(m_file) == 0 && ok;
+
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    m_pending_lines = 0;
+    m_pending_error = false;
+    m_checked = 0;
+
+    return ok;
+}
+
+int DiagnosticBuf::overflow(int c)
+{
+    if (!flush())
+        return traits_type::eof();
+
+    if (c != traits_type::eof())
+    {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+}
+
+std::streamsize DiagnosticBuf::xsputn(const char *data, std::streamsize size)
+{
+    std::streamsize written = 0;
+
+    while (written < size)
+    {
+        if (pptr() == epptr() && !flush())
+            break;
+
+        const std::streamsize count = std::min(size - written, static_cast<std::streamsize>(epptr() - pptr()));
+
+        std::memcpy(pptr(), data + written, static_cast<size_t>(count));
+        pbump(static_cast<int>(count));
+        written += count;
+    }
+
+    return written;
+}
+
+// Called for every std::endl and, because std::cerr is unitbuf, after
+// everything written to it. Only complete lines are written.
+int DiagnosticBuf::sync()
+{
+    const std::string_view text(pbase() + m_checked, static_cast<size_t>(pptr() - pbase()) - m_checked);
+    const size_t end = text.rfind('\n');
+
+    if (end == std::string_view::npos)
+        return 0;
+
+    const std::string_view lines = text.substr(0, end + 1);
+
+    m_pending_lines += static_cast<size_t>(std::count(lines.begin(), lines.end(), '\n'));
+    m_checked += lines.size();
+
+    bool write = false;
+
+    switch (m_policy)
+    {
+    case Policy::lines:
+        write = m_pending_lines >= m_lines;
+        break;
+    case Policy::error:
+        write = m_pending_error;
+        break;
+    case Policy::exit:
+        break;
+    }
+
+    if (write)
+    {
+        // a partial line stays in the buffer
+        const size_t partial = static_cast<size_t>(pptr() - pbase()) - m_checked;
+        const size_t size = m_checked;
+
+        if (std::fwrite(pbase(), 1, size, m_file) != size || std::fflush(m_file) != 0)
+            return -1;
+
+        std::memmove(m_buffer.data(), m_buffer.data() + size, partial);
+        setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+        pbump(static_cast<int>(partial));
+        m_pending_lines = 0;
+        m_pending_error = false;
+        m_checked = 0;
+    }
+
+    return 0;
+}
+
+int DiagnosticBuf::Flusher::sync()
+{
+    return m_buf.flush() ? 0 : -1;
+}
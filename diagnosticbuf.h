@@ -0,0 +1,103 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#ifndef DIAGNOSTICBUF_H
+#define DIAGNOSTICBUF_H
+
+#include <cstdio>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// A stream buffer for diagnostics that collects them in a large buffer
+// and writes them in blocks instead of writing every part of every line
+// like an unbuffered std::cerr does.
+//
+// When the buffer is written depends on the flush policy: after every
+// lines complete lines (1 keeps the output in the same order as other
+// output), after the line of an error or only when the buffer is full.
+// Everything left is written when it is destroyed. Errors are told apart
+// by error() being called for them, not by what they say, so it works
+// for every output format.
+class DiagnosticBuf : public std::streambuf
+{
+public:
+    enum class Policy { lines, error, exit };
+
+    DiagnosticBuf();
+    ~DiagnosticBuf() override;
+
+    DiagnosticBuf(const DiagnosticBuf &) = delete;
+    DiagnosticBuf &operator=(const DiagnosticBuf &) = delete;
+
+    // write to a file or an open file descriptor instead of stderr
+    bool open(const std::string &file);
+    bool open(int fd);
+
+    void policy(Policy policy, size_t lines = 1)
+    {
+        m_policy = policy;
+        m_lines = lines;
+    }
+
+    // if it is writing to a terminal
+    bool terminal() const;
+
+    // the next complete line is, or finishes, an error
+    void error()
+    {
+        m_pending_error = true;
+    }
+
+    // write everything buffered regardless of the policy
+    bool flush();
+
+    // A stream buffer that only writes everything buffered in a
+    // DiagnosticBuf when it is flushed. Output tied to a stream using it
+    // comes after the diagnostics written before it whatever the policy.
+    class Flusher : public std::streambuf
+    {
+    public:
+        explicit Flusher(DiagnosticBuf &buf) : m_buf(buf) {}
+
+    protected:
+        int sync() override;
+
+    private:
+        DiagnosticBuf &m_buf;
+    };
+
+protected:
+    int overflow(int c) override;
+    std::streamsize xsputn(const char *data, std::streamsize size) override;
+    int sync() override;
+
+private:
+    std::FILE         *m_file = stderr;
+    bool               m_close = false;
+    std::vector<char>  m_buffer;
+    Policy             m_policy = Policy::exit;
+    size_t             m_lines = 1;
+    size_t             m_pending_lines = 0;
+    bool               m_pending_error = false;
+    size_t             m_checked = 0; // how much of the buffer was checked for lines
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#include "gzipstream.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// 15 bits of window plus 16 for a gzip header and trailer instead of zlib
+const int window_bits = 15 + 16;
+
+} // namespace
+
+GzipStreamBuf::GzipStreamBuf(std::streambuf *out, int level) : m_out(out), m_buffer(256 * 1024)
+{
+    m_ok = deflateInit2(&m_stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+GzipStreamBuf::~GzipStreamBuf()
+{
+    finish();
+    deflateEnd(&m_stream);
+}
+
+bool GzipStreamBuf::finish()
+{
+    if (!m_finished)
+    {
+        m_finished = true;
+
+        if (m_ok)
+            m_ok = compress(nullptr, 0, Z_FINISH);
+    }
+
+    return m_ok;
+}
+
+int GzipStreamBuf::overflow(int c)
+{
+    if (c == traits_type::eof())
+        return traits_type::not_eof(c);
+
+    const char ch = traits_type::to_char_type(c);
+
+    if (xsputn(&ch, 1) != 1)
+        return traits_type::eof();
+
+    return c;
+}
+
+std::streamsize GzipStreamBuf::xsputn(const char *data, std::streamsize size)
+{
+    if (!m_ok || m_finished)
+        return 0;
+
+    m_ok = compress(data, static_cast<size_t>(size), Z_NO_FLUSH);
+
+    return m_ok ? size : 0;
+}
+
+bool GzipStreamBuf::compress(const char *data, size_t size, int flush)
+{
+    // avail_in is only 32 bits so very large writes are done in pieces
+    const size_t max_size = std::numeric_limits<uInt>::max();
+
+    do
+    {
+        const size_t count = std::min(size, max_size);
+        const int piece_flush = count == size ? flush : Z_NO_FLUSH;
+
+        m_stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+        m_stream.avail_in = static_cast<uInt>(count);
+
+        int status;
+
+        do
+        {
+            m_stream.next_out = reinterpret_cast<Bytef *>(m_buffer.data());
+            m_stream.avail_out = static_cast<uInt>(m_buffer.size());
+
+            status = deflate(&m_stream, piece_flush);
+            if (status == Z_STREAM_ERROR)
+                return false;
+
+            const std::streamsize have = static_cast<std::streamsize>(m_buffer.size() - m_stream.avail_out);
+
+            if (have != 0 && m_out->sputn(m_buffer.data(), have) != have)
+                return false;
+        } while (m_stream.avail_out == 0);
+
+        if (piece_flush == Z_FINISH && status != Z_STREAM_END)
+            return false;
+
+        data += count;
+        size -= count;
+    } while (size != 0);
+
+    return true;
+}
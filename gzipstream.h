@@ -0,0 +1,62 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#ifndef GZIPSTREAM_H
+#define GZIPSTREAM_H
+
+#include <streambuf>
+#include <vector>
+
+#include <zlib.h>
+
+// A stream buffer that gzip compresses everything written to it and
+// passes the compressed data on to another stream buffer (e.g. the one
+// of an std::ofstream). The data is compressed as it is written so the
+// whole file is never kept in memory.
+//
+// finish() must be called after the last write to complete the file.
+class GzipStreamBuf : public std::streambuf
+{
+public:
+    // level is a zlib compression level: 0 to 9 or -1 for the default
+    GzipStreamBuf(std::streambuf *out, int level);
+    ~GzipStreamBuf() override;
+
+    GzipStreamBuf(const GzipStreamBuf &) = delete;
+    GzipStreamBuf &operator=(const GzipStreamBuf &) = delete;
+
+    // returns false if anything couldn't be compressed or written
+    bool finish();
+
+protected:
+    int overflow(int c) override;
+    std::streamsize xsputn(const char *data, std::streamsize size) override;
+
+private:
+    bool compress(const char *data, size_t size, int flush);
+
+    std::streambuf   *m_out;
+    z_stream          m_stream = {};
+    std::vector<char> m_buffer;
+    bool              m_ok = false;
+    bool              m_finished = false;
+};
+
+#endif
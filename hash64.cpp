@@ -0,0 +1,193 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#include "hash64.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+const std::uint64_t prime1 = 11400714785074694791ULL;
+const std::uint64_t prime2 = 14029467366897019727ULL;
+const std::uint64_t prime3 = 1609587929392839161ULL;
+const std::uint64_t prime4 = 9650029242287828579ULL;
+const std::uint64_t prime5 = 2870177450012600261ULL;
+
+std::uint64_t rotl(std::uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// little endian regardless of the machine
+std::uint64_t read64(const unsigned char *data)
+{
+    std::uint64_t value = 0;
+
+    for (int i = 7; i >= 0; --i)
+        value = (value << 8) | data[i];
+
+    return value;
+}
+
+std::uint64_t read32(const unsigned char *data)
+{
+    return static_cast<std::uint64_t>(data[0]) | (static_cast<std::uint64_t>(data[1]) << 8) |
+        (static_cast<std::uint64_t>(data[2]) << 16) | (static_cast<std::uint64_t>(data[3]) << 24);
+}
+
+std::uint64_t hashRound(std::uint64_t acc, std::uint64_t input)
+{
+    acc += input * prime2;
+    acc = rotl(acc, 31);
+    return acc * prime1;
+}
+
+std::uint64_t mergeRound(std::uint64_t acc, std::uint64_t value)
+{
+    acc ^= hashRound(0, value);
+    return acc * prime1 + prime4;
+}
+
+} // namespace
+
+Hash64::Hash64(std::uint64_t seed) : m_seed(seed)
+{
+    m_v[0] = seed + prime1 + prime2;
+    m_v[1] = seed + prime2;
+    m_v[2] = seed;
+    m_v[3] = seed - prime1;
+}
+
+void Hash64::update(const void *data, size_t size)
+{
+    const unsigned char *input = static_cast<const unsigned char *>(data);
+
+    m_total += size;
+
+    // finish a stripe started by an earlier call
+    if (m_buffered != 0)
+    {
+        const size_t count = std::min(size, sizeof(m_buffer) - m_buffered);
+
+        std::memcpy(m_buffer + m_buffered, input, count);
+        m_buffered += count;
+        input += count;
+        size -= count;
+
+        if (m_buffered < sizeof(m_buffer))
+            return;
+
+        for (size_t i = 0; i < 4; ++i)
+            m_v[i] = hashRound(m_v[i], read64(m_buffer + i * 8));
+
+        m_buffered = 0;
+    }
+
+    while (size >= 32)
+    {
+        for (size_t i = 0; i < 4; ++i)
+            m_v[i] = hashRound(m_v[i], read64(input + i * 8));
+
+        input += 32;
+        size -= 32;
+    }
+
+    std::memcpy(m_buffer, input, size);
+    m_buffered = size;
+}
+
+std::uint64_t Hash64::digest() const
+{
+    std::uint64_t hash;
+
+    if (m_total >= 32)
+    {
+        hash = rotl(m_v[0], 1) + rotl(m_v[1], 7) + rotl(m_v[2], 12) + rotl(m_v[3], 18);
+
+        for (size_t i = 0; i < 4; ++i)
+            hash = mergeRound(hash, m_v[i]);
+    }
+    else
+        hash = m_seed + prime5;
+
+    hash += m_total;
+
+    const unsigned char *input = m_buffer;
+    size_t size = m_buffered;
+
+    while (size >= 8)
+    {
+        hash ^= hashRound(0, read64(input));
+        hash = rotl(hash, 27) * prime1 + prime4;
+        input += 8;
+        size -= 8;
+    }
+
+    if (size >= 4)
+    {
+        hash ^= read32(input) * prime1;
+        hash = rotl(hash, 23) * prime2 + prime3;
+        input += 4;
+        size -= 4;
+    }
+
+    while (size > 0)
+    {
+        hash ^= *input * prime5;
+        hash = rotl(hash, 11) * prime1;
+        input++;
+        size--;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+bool Hash64::file(const std::string &path, std::uint64_t &hash)
+{
+    std::ifstream in(path, std::ifstream::binary);
+
+    if (!in)
+        return false;
+
+    Hash64 hasher;
+    std::vector<char> buffer(64 * 1024);
+
+    while (in)
+    {
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        hasher.update(buffer.data(), static_cast<size_t>(in.gcount()));
+    }
+
+    if (in.bad())
+        return false;
+
+    hash = hasher.digest();
+
+    return true;
+}
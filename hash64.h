@@ -0,0 +1,50 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#ifndef HASH64_H
+#define HASH64_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A fast 64 bit hash of file contents used to tell if two textures are
+// the same without comparing them byte by byte. It is the XXH64 algorithm
+// so the values are the same as the xxhsum tool gives.
+class Hash64
+{
+public:
+    explicit Hash64(std::uint64_t seed = 0);
+
+    void update(const void *data, size_t size);
+    std::uint64_t digest() const;
+
+    // hash of the whole file, returns false if it couldn't be read
+    static bool file(const std::string &path, std::uint64_t &hash);
+
+private:
+    std::uint64_t m_seed = 0;
+    std::uint64_t m_v[4] = {};
+    unsigned char m_buffer[32] = {};
+    size_t        m_buffered = 0;
+    std::uint64_t m_total = 0;
+};
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#ifndef PERTHREAD_H
+#define PERTHREAD_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A T for each thread that uses it so each thread can change its own
+// without a lock. Only the first local() of a thread takes the lock to make
+// its T. The thread remembers which instance it last used so a new instance
+// gives it a new T. forEach() must only be called when nothing is using
+// them.
+template <typename T>
+class PerThread
+{
+public:
+    PerThread() : m_id(next_id++)
+    {
+    }
+
+    PerThread(const PerThread &) = delete;
+    PerThread &operator=(const PerThread &) = delete;
+
+    T &local()
+    {
+        struct Cache
+        {
+            size_t  id = 0;
+            T      *value = nullptr;
+        };
+
+        thread_local Cache cache;
+
+        if (cache.id != m_id)
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+
+            m_values.push_back(std::make_unique<T>());
+            cache.id = m_id;
+            cache.value = m_values.back().get();
+        }
+
+        return *cache.value;
+    }
+
+    // function(value, number) for the T of every thread, numbered from 1
+    // in the order the threads first used them
+    template <typename Function>
+    void forEach(const Function &function) const
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (size_t i = 0; i < m_values.size(); ++i)
+            function(static_cast<const T &>(*m_values[i]), i + 1);
+    }
+
+private:
+    static inline std::atomic<size_t> next_id = 1;
+
+    const size_t                     m_id;
+    mutable std::mutex               m_mutex;
+    std::vector<std::unique_ptr<T>>  m_values;
+};
+
+#endif
@@ -0,0 +1,299 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <list>
+#include <string>
+
+#include "diagnostic.h"
+#include "writer.h"
+
+namespace {
+
+// The times of all the threads added together. A list so rows don't move
+// when more are added.
+struct Row
+{
+    std::string     name;
+    size_t          calls = 0;
+    double          total = 0;
+    double          max = 0;
+    size_t          threads = 0;
+    std::list<Row>  children;
+};
+
+double milliseconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+Row &findRow(std::list<Row> &rows, const char *name)
+{
+    for (auto &row : rows)
+    {
+        if (row.name == name)
+            return row;
+    }
+
+    rows.emplace_back();
+    rows.back().name = name;
+
+    return rows.back();
+}
+
+void sortRows(std::list<Row> &rows)
+{
+    rows.sort([](const Row &a, const Row &b) { return a.total > b.total; });
+
+    for (auto &row : rows)
+        sortRows(row.children);
+}
+
+void showRows(std::ostream &out, const std::list<Row> &rows, size_t level)
+{
+    for (const auto &row : rows)
+    {
+        const std::string name = std::string(level * 2, ' ') + row.name;
+
+        out << std::left << std::setw(44) << name << std::right
+            << std::setw(10) << row.calls
+            << std::setw(12) << row.total
+            << std::setw(12) << row.max
+            << std::setw(8) << row.threads << std::endl;
+
+        showRows(out, row.children, level + 1);
+    }
+}
+
+} // namespace
+
+Profiler::Profiler() : m_start(Clock::now())
+{
+}
+
+void Profiler::Scope::start(Profiler *profiler, const char *name, Trace trace)
+{
+    Thread &thread = profiler->m_threads.local();
+
+    m_traced = profiler->m_tracing && trace == Trace::yes;
+
+    // A recursive call is already being timed by the first one but it is
+    // still a span of its own.
+    if (thread.current != none && std::strcmp(thread.nodes[thread.current].name, name) == 0)
+    {
+        if (m_traced)
+        {
+            m_profiler = profiler;
+            m_name = name;
+            m_node = none;
+            m_start = Clock::now();
+        }
+        return;
+    }
+
+    const std::vector<size_t> *children = nullptr;
+
+    if (thread.current != none)
+        children = &thread.nodes[thread.current].children;
+
+    size_t node = none;
+
+    if (children != nullptr)
+    {
+        for (const size_t child : *children)
+        {
+            if (std::strcmp(thread.nodes[child].name, name) == 0)
+            {
+                node = child;
+                break;
+            }
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < thread.nodes.size(); ++i)
+        {
+            if (thread.nodes[i].parent == none && std::strcmp(thread.nodes[i].name, name) == 0)
+            {
+                node = i;
+                break;
+            }
+        }
+    }
+
+    if (node == none)
+    {
+        node = thread.nodes.size();
+        thread.nodes.emplace_back();
+        thread.nodes.back().name = name;
+        thread.nodes.back().parent = thread.current;
+
+        if (thread.current != none)
+            thread.nodes[thread.current].children.push_back(node);
+    }
+
+    thread.current = node;
+
+    m_profiler = profiler;
+    m_name = name;
+    m_node = node;
+    m_start = Clock::now();
+}
+
+void Profiler::Scope::stop()
+{
+    const Clock::duration duration = Clock::now() - m_start;
+    Thread &thread = m_profiler->m_threads.local();
+
+    if (m_traced)
+        thread.spans.push_back({ m_name, m_start, duration, std::move(m_arg) });
+
+    if (m_node == none)
+        return;
+
+    Node &node = thread.nodes[m_node];
+
+    node.calls++;
+    node.total += duration;
+    node.max = std::max(node.max, duration);
+
+    thread.current = node.parent;
+}
+
+void Profiler::report(std::ostream &out) const
+{
+    std::list<Row> rows;
+
+    m_threads.forEach([&rows](const Thread &thread, size_t)
+    {
+        // the row of each node of this thread
+        std::vector<Row *> thread_rows(thread.nodes.size(), nullptr);
+
+        // parents are always added before their children
+        for (size_t i = 0; i < thread.nodes.size(); ++i)
+        {
+            const Node &node = thread.nodes[i];
+            std::list<Row> &siblings = node.parent == none ? rows : thread_rows[node.parent]->children;
+            Row &row = findRow(siblings, node.name);
+
+            row.calls += node.calls;
+            row.total += milliseconds(node.total);
+            row.max = std::max(row.max, milliseconds(node.max));
+            row.threads++;
+
+            thread_rows[i] = &row;
+        }
+    });
+
+    sortRows(rows);
+
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+
+    out << std::left << std::setw(44) << "profile" << std::right
+        << std::setw(10) << "calls"
+        << std::setw(12) << "total ms"
+        << std::setw(12) << "max ms"
+        << std::setw(8) << "threads" << std::endl;
+    out << std::fixed << std::setprecision(3);
+
+    showRows(out, rows, 0);
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+std::vector<Profiler::Total> Profiler::totals() const
+{
+    std::vector<Total> result;
+
+    m_threads.forEach([&result](const Thread &thread, size_t)
+    {
+        for (const auto &node : thread.nodes)
+        {
+            auto it = std::find_if(result.begin(), result.end(), [&node](const Total &total) { return total.name == node.name; });
+
+            if (it == result.end())
+            {
+                result.emplace_back();
+                result.back().name = node.name;
+                it = result.end() - 1;
+            }
+
+            it->calls += node.calls;
+            it->total += milliseconds(node.total);
+        }
+    });
+
+    return result;
+}
+
+bool Profiler::writeTrace(const std::string &file) const
+{
+    std::ofstream of(file, std::ofstream::binary);
+
+    if (!of)
+        return false;
+
+    {
+        Writer out(of);
+        bool first = true;
+
+        out << "{\"traceEvents\":[\n";
+
+        m_threads.forEach([this, &out, &first](const Thread &thread, size_t id)
+        {
+            if (!first)
+                out << ",\n";
+            first = false;
+
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << id
+                << ",\"args\":{\"name\":\"thread " << id << "\"}}";
+
+            for (const auto &span : thread.spans)
+            {
+                const auto start = std::chrono::duration_cast<std::chrono::microseconds>(span.start - m_start);
+                const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(span.duration);
+
+                out << ",\n{\"name\":\"" << span.name << "\",\"cat\":\"acclint\",\"ph\":\"X\",\"ts\":"
+                    << static_cast<long long>(start.count()) << ",\"dur\":" << static_cast<long long>(duration.count())
+                    << ",\"pid\":1,\"tid\":" << id;
+
+                if (!span.arg.empty())
+                {
+                    out << ",\"args\":{\"name\":";
+                    writeJsonString(out, span.arg);
+                    out << '}';
+                }
+
+                out << '}';
+            }
+        });
+
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+    return static_cast<bool>(of.flush());
+}
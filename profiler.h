@@ -0,0 +1,152 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "perthread.h"
+
+// Times the parts of a run that are inside a Scope. Scopes inside other
+// scopes on the same thread are shown below them, and every call of a
+// scope with the same name and parents is added together.
+//
+// When tracing, the larger scopes are also kept as spans of time on each
+// thread and written as a Chrome trace that chrome://tracing and Perfetto
+// can show.
+//
+// Each thread keeps its own times so timing doesn't need a lock. They are
+// added together by report() and writeTrace() which must only be called
+// when nothing is being timed.
+class Profiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Profiler();
+
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    // keep the spans of scopes made with Trace::yes
+    void tracing(bool value)
+    {
+        m_tracing = value;
+    }
+
+    enum class Trace { no, yes };
+
+    // Times from when it's made until it goes out of scope. It does
+    // nothing when there is no profiler, so it can always be used.
+    class Scope
+    {
+    public:
+        Scope(Profiler *profiler, const char *name, Trace trace = Trace::no)
+        {
+            if (profiler != nullptr)
+                start(profiler, name, trace);
+        }
+
+        ~Scope()
+        {
+            if (m_profiler != nullptr)
+                stop();
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        // what the span is about, like the name of an object
+        void arg(std::string_view value)
+        {
+            if (m_traced)
+                m_arg = value;
+        }
+
+    private:
+        void start(Profiler *profiler, const char *name, Trace trace);
+        void stop();
+
+        Profiler          *m_profiler = nullptr;
+        const char        *m_name = nullptr;
+        size_t             m_node = 0;
+        bool               m_traced = false;
+        std::string        m_arg;
+        Clock::time_point  m_start;
+    };
+
+    // a table of the calls, total and longest time and number of threads
+    // of every scope, the slowest first
+    void report(std::ostream &out) const;
+
+    struct Total
+    {
+        std::string name;
+        size_t      calls = 0;
+        double      total = 0;  // milliseconds
+    };
+
+    // the calls and total time of every scope added together wherever it
+    // was called from, in the order they were first called
+    std::vector<Total> totals() const;
+
+    // the spans in Chrome trace event format
+    bool writeTrace(const std::string &file) const;
+
+private:
+    static constexpr size_t none = static_cast<size_t>(-1);
+
+    struct Node
+    {
+        const char          *name = nullptr;
+        size_t               parent = none;
+        std::vector<size_t>  children;
+        size_t               calls = 0;
+        Clock::duration      total{};
+        Clock::duration      max{};
+    };
+
+    struct Span
+    {
+        const char        *name = nullptr;
+        Clock::time_point  start;
+        Clock::duration    duration{};
+        std::string        arg;
+    };
+
+    struct Thread
+    {
+        std::vector<Node> nodes;
+        size_t            current = none;
+        std::vector<Span> spans;
+    };
+
+    const Clock::time_point  m_start;
+    bool                     m_tracing = false;
+    PerThread<Thread>        m_threads;
+};
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#include "stats.h"
+
+#include <iomanip>
+#include <iterator>
+#include <string>
+
+namespace {
+
+struct Name
+{
+    Stats::Counter  counter;
+    const char     *check;
+    const char     *name;
+};
+
+// in the order they are shown, the counters of a check together
+constexpr Name names[] =
+{
+    { Stats::overlap_triangle_pairs,             "overlapping-2-sided-surface", "triangle pairs" },
+    { Stats::overlap_bounding_box_rejects,       "overlapping-2-sided-surface", "bounding box rejects" },
+    { Stats::overlap_shared_vertices,            "overlapping-2-sided-surface", "shared vertex shortcuts" },
+    { Stats::overlap_coplanar_rejects,           "overlapping-2-sided-surface", "coplanar rejects" },
+    { Stats::overlap_triangle_intersects,        "overlapping-2-sided-surface", "TriangleIntersects calls" },
+    { Stats::overlap_point_in_triangle,          "overlapping-2-sided-surface", "pointInCoplanarTriangle fallbacks" },
+    { Stats::self_intersecting_surfaces,         "surface-self-intersecting",   "surfaces" },
+    { Stats::self_intersecting_skipped_vertices, "surface-self-intersecting",   "skipped vertices" },
+    { Stats::self_intersecting_segment_pairs,    "surface-self-intersecting",   "segment pairs" },
+    { Stats::duplicate_vertices_pairs,           "duplicate-vertices",          "vertex pairs" },
+    { Stats::duplicate_vertices_found,           "duplicate-vertices",          "duplicates" },
+    { Stats::duplicate_triangles_pairs,          "duplicate-triangles",         "triangle pairs" },
+    { Stats::duplicate_surfaces_pairs,           "duplicate-surfaces",          "surface pairs" },
+    { Stats::duplicate_surface_vertices_pairs,   "duplicate-surface-vertices",  "ref pairs" },
+};
+
+static_assert(std::size(names) == Stats::counters, "every counter needs a name");
+
+} // namespace
+
+void Stats::report(std::ostream &out) const
+{
+    Counts totals{};
+
+    m_threads.forEach([&totals](const ThreadCounts &thread, size_t)
+    {
+        for (size_t i = 0; i < counters; ++i)
+            totals[i] += thread.counts[i];
+    });
+
+    const std::ios_base::fmtflags flags = out.flags();
+
+    out << std::left << std::setw(44) << "stats" << std::right << std::setw(16) << "count" << std::endl;
+
+    for (size_t i = 0; i < std::size(names); ++i)
+    {
+        const std::string check = names[i].check;
+
+        // the first counter of a check
+        if (i != 0 && check == names[i - 1].check)
+            continue;
+
+        bool used = false;
+
+        for (size_t j = i; j < std::size(names) && check == names[j].check; ++j)
+            used = used || totals[names[j].counter] != 0;
+
+        if (!used)
+            continue;
+
+        out << check << std::endl;
+
+        for (size_t j = i; j < std::size(names) && check == names[j].check; ++j)
+        {
+            out << std::left << std::setw(44) << (std::string("  ") + names[j].name) << std::right
+                << std::setw(16) << totals[names[j].counter] << std::endl;
+        }
+    }
+
+    out.flags(flags);
+}
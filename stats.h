@@ -0,0 +1,97 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <array>
+#include <cstddef>
+#include <ostream>
+
+#include "perthread.h"
+
+// Counts the work done by the expensive checks so a slow check can be
+// explained: how many pairs it looked at and where they were decided.
+//
+// Each thread has its own counts, aligned to and padded out to whole cache
+// lines, so counting doesn't need a lock or share cache lines with anything
+// else. They are added together by report() which must only be called when
+// nothing is being counted.
+class Stats
+{
+public:
+    enum Counter
+    {
+        overlap_triangle_pairs,
+        overlap_bounding_box_rejects,
+        overlap_shared_vertices,
+        overlap_coplanar_rejects,
+        overlap_triangle_intersects,
+        overlap_point_in_triangle,
+
+        self_intersecting_surfaces,
+        self_intersecting_skipped_vertices,
+        self_intersecting_segment_pairs,
+
+        duplicate_vertices_pairs,
+        duplicate_vertices_found,
+
+        duplicate_triangles_pairs,
+
+        duplicate_surfaces_pairs,
+
+        duplicate_surface_vertices_pairs,
+
+        counters
+    };
+
+    using Counts = std::array<size_t, counters>;
+
+    Stats() = default;
+
+    Stats(const Stats &) = delete;
+    Stats &operator=(const Stats &) = delete;
+
+    // the counts of this thread or nullptr when there are no stats
+    static Counts *counts(Stats *stats)
+    {
+        return stats != nullptr ? &stats->m_threads.local().counts : nullptr;
+    }
+
+    static void add(Counts *counts, Counter counter, size_t value = 1)
+    {
+        if (counts != nullptr)
+            (*counts)[counter] += value;
+    }
+
+    // a table of the counts of every check that did something
+    void report(std::ostream &out) const;
+
+private:
+    // 64 bytes is the cache line size of x86-64 and most ARM processors
+    struct alignas(64) ThreadCounts
+    {
+        Counts counts{};
+    };
+
+    PerThread<ThreadCounts> m_threads;
+};
+
+#endif
@@ -11,7 +11,7 @@ setup() {
 # Delete any *.output debug files left over from a previous run before
 # running any tests in this file.
 setup_file() {
-    rm -f ./*.output
+    rm -f ./*.output ./*.output.json
 }
 
 ################################################################################
@@ -156,3 +156,124 @@ setup_file() {
 }
 
 ################################################################################
+
+################################################################################
+# --compressionLevel takes a zlib compression level from 0 to 9.
+################################################################################
+
+# test16: missing --compressionLevel argument
+@test "test16" {
+  $RUN_TEST acclint test1.ac --compressionLevel
+  [ "$status" -ne 0 ]
+  [ "$(echo "${lines[0]}" | tr -d '\r')" = "Missing compression level" ]
+}
+
+# test17: invalid --compressionLevel argument
+@test "test17" {
+  $RUN_TEST acclint test1.ac --compressionLevel 10
+  [ "$status" -ne 0 ]
+  [ "$(echo "${lines[0]}" | tr -d '\r')" = "Invalid compression level: 10" ]
+}
+
+################################################################################
+# Diagnostics options.
+################################################################################
+
+# test18: missing --flushDiagnostics argument
+@test "test18" {
+  $RUN_TEST acclint test1.ac --flushDiagnostics
+  [ "$status" -ne 0 ]
+  [ "$(echo "${lines[0]}" | tr -d '\r')" = "Missing flush policy" ]
+}
+
+# test19: invalid --flushDiagnostics argument
+@test "test19" {
+  $RUN_TEST acclint test1.ac --flushDiagnostics 0
+  [ "$status" -ne 0 ]
+  [ "$(echo "${lines[0]}" | tr -d '\r')" = "Invalid flush policy: 0" ]
+}
+
+# test20: missing --diagnostics argument
+@test "test20" {
+  $RUN_TEST acclint test1.ac --diagnostics
+  [ "$status" -ne 0 ]
+  [ "$(echo "${lines[0]}" | tr -d '\r')" = "Missing diagnostics file" ]
+}
+
+# test21: missing --format argument
+@test "test21" {
+  $RUN_TEST acclint test1.ac --format
+  [ "$status" -ne 0 ]
+  [ "$(echo "${lines[0]}" | tr -d '\r')" = "Missing format" ]
+}
+
+# test22: invalid --format argument
+@test "test22" {
+  $RUN_TEST acclint test1.ac --format xml
+  [ "$status" -ne 0 ]
+  [ "$(echo "${lines[0]}" | tr -d '\r')" = "Invalid format: xml" ]
+}
+
+# test23: missing --max-diagnostics argument
+@test "test23" {
+  $RUN_TEST acclint test1.ac --max-diagnostics
+  [ "$status" -ne 0 ]
+  [ "$(echo "${lines[0]}" | tr -d '\r')" = "Missing maximum number of diagnostics" ]
+}
+
+# test24: invalid --max-diagnostics argument
+@test "test24" {
+  $RUN_TEST acclint test1.ac --max-diagnostics -1
+  [ "$status" -ne 0 ]
+  [ "$(echo "${lines[0]}" | tr -d '\r')" = "Invalid maximum number of diagnostics: -1" ]
+}
+
+# test25: missing --max-<warning> argument
+@test "test25" {
+  $RUN_TEST acclint test1.ac --max-trailing-text
+  [ "$status" -ne 0 ]
+  [ "$(echo "${lines[0]}" | tr -d '\r')" = "Missing maximum number of trailing-text diagnostics" ]
+}
+
+# test26: invalid --max-<warning> argument
+@test "test26" {
+  $RUN_TEST acclint test1.ac --max-trailing-text=x
+  [ "$status" -ne 0 ]
+  [ "$(echo "${lines[0]}" | tr -d '\r')" = "Invalid maximum number of trailing-text diagnostics: x" ]
+}
+
+# test27: --showTimes shows how long reading and each check took
+@test "test27" {
+  $RUN_TEST acclint --showTimes -Wno-warnings test1.ac
+  [ "$status" -eq 0 ]
+  echo "$output" | grep -q '^profile  *calls  *total ms  *max ms  *threads'
+  echo "$output" | grep -q '^read  *1 '
+  echo "$output" | grep -q '^  readObject  *1 '
+}
+
+# test28: missing --trace argument
+@test "test28" {
+  $RUN_TEST acclint test1.ac --trace
+  [ "$status" -ne 0 ]
+  [ "$(echo "${lines[0]}" | tr -d '\r')" = "Missing trace file" ]
+}
+
+# test29: --trace writes a Chrome trace
+@test "test29" {
+  $RUN_TEST acclint -Wno-warnings --trace test29.output.json test1.ac
+  [ "$status" -eq 0 ]
+  grep -q '^{"traceEvents":\[$' test29.output.json
+  grep -q '^{"name":"read","cat":"acclint","ph":"X","ts":[0-9]*,"dur":[0-9]*,"pid":1,"tid":1,"args":{"name":"test1.ac"}}' test29.output.json
+  grep -q '^{"name":"readObject",' test29.output.json
+  rm test29.output.json
+}
+
+# test30: --memory-report shows the memory used after reading
+@test "test30" {
+  $RUN_TEST acclint --memory-report test1.ac
+  [ "$status" -eq 0 ]
+  echo "$output" | grep -q '^memory after read: [0-9]* bytes, peak memory: [0-9]* bytes$'
+  echo "$output" | grep -q '^object  *vertices  *refs  *uv  *strips  *triangles  *materials  *strings  *line info  *other  *total$'
+  echo "$output" | grep -q '^1 world  *0  *0  *0  *0  *0  *0  *0 '
+  echo "$output" | grep -q '^total '
+}
@@ -29,6 +29,20 @@ setup_file() {
   rm test1.output.acc
 }
 
+# the same conversion written as a gzip compressed file
+@test "test1.gz" {
+  $RUN_TEST acclint test1.ac --compressionLevel 9 -o test1.output.acc.gz
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test1.gz.output
+  fi
+  [ "$output" = "" ]
+  actual_file="$(gzip -dc test1.output.acc.gz | tr -d '\r')"
+  expected_file="$(tr -d '\r' < test1.result.acc)"
+  [ "$actual_file" = "$expected_file" ]
+  rm test1.output.acc.gz
+}
+
 ################################################################################
 
 @test "test2" {
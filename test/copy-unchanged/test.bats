@@ -0,0 +1,58 @@
+#!/usr/bin/env bats
+
+setup() {
+    if [[ "$(uname)" == "Linux" ]]; then
+        export RUN_TEST="run valgrind --leak-check=full --error-exitcode=1 --quiet"
+    else
+        export RUN_TEST="run"
+    fi
+}
+
+# Delete any *.output debug files left over from a previous run before
+# running any tests in this file.
+setup_file() {
+    rm -f ./*.output
+}
+
+################################################################################
+
+# the object with duplicate vertices is cleaned and written again, the other
+# object is copied with its original formatting
+@test "test1" {
+  $RUN_TEST acclint -Wno-warnings --copyUnchanged test1.ac -o test1.output.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test1.output
+  fi
+  [ "$output" = "" ]
+  actual_file="$(tr -d '\r' < test1.output.ac)"
+  expected_file="$(tr -d '\r' < test1.result.ac)"
+  [ "$actual_file" = "$expected_file" ]
+  rm test1.output.ac
+}
+
+# objects with trailing text are always written again
+@test "test2" {
+  $RUN_TEST acclint -Wno-warnings -Wtrailing-text --copyUnchanged test2.ac -o test2.output.ac
+  [ "$status" -eq 0 ]
+  [ "${#lines[@]}" -eq 4 ]
+  actual_file="$(tr -d '\r' < test2.output.ac)"
+  expected_file="$(tr -d '\r' < test2.result.ac)"
+  [ "$actual_file" = "$expected_file" ]
+  rm test2.output.ac
+}
+
+# the repeated name, the trailing text and the blank line still keep the
+# object from being copied when their warnings are off
+@test "test3" {
+  $RUN_TEST acclint -Wno-warnings --copyUnchanged test3.ac -o test3.output.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test3.output
+  fi
+  [ "$output" = "" ]
+  actual_file="$(tr -d '\r' < test3.output.ac)"
+  expected_file="$(tr -d '\r' < test3.result.ac)"
+  [ "$actual_file" = "$expected_file" ]
+  rm test3.output.ac
+}
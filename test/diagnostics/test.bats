@@ -0,0 +1,195 @@
+#!/usr/bin/env bats
+
+setup() {
+    if [[ "$(uname)" == "Linux" ]]; then
+        export RUN_TEST="run valgrind --leak-check=full --error-exitcode=1 --quiet"
+    else
+        export RUN_TEST="run"
+    fi
+}
+
+# Delete any *.output debug files left over from a previous run before
+# running any tests in this file.
+setup_file() {
+    rm -f ./*.output ./*.output.txt
+}
+
+################################################################################
+
+# buffered until exit
+@test "test1.1" {
+  $RUN_TEST acclint --flushDiagnostics exit test1.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test1.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test1.1.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# buffered until there are enough lines
+@test "test1.2" {
+  $RUN_TEST acclint --flushDiagnostics 4 test1.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test1.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test1.2.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# written to a file
+@test "test1.3" {
+  $RUN_TEST acclint --diagnostics test1.3.output.txt test1.ac
+  [ "$status" -eq 0 ]
+  [ "$output" = "" ]
+  actual="$(tr -d '\r' < test1.3.output.txt)"
+  expected="$(tr -d '\r' < test1.result)"
+  [ "$actual" = "$expected" ]
+  rm test1.3.output.txt
+}
+
+# written to a file descriptor
+@test "test1.4" {
+  $RUN_TEST acclint --diagnosticsFd 3 test1.ac 3> test1.4.output.txt
+  [ "$status" -eq 0 ]
+  [ "$output" = "" ]
+  actual="$(tr -d '\r' < test1.4.output.txt)"
+  expected="$(tr -d '\r' < test1.result)"
+  [ "$actual" = "$expected" ]
+  rm test1.4.output.txt
+}
+
+# JSON Lines
+@test "test1.5" {
+  $RUN_TEST acclint --format jsonl test1.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test1.jsonl)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test1.5.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# SARIF with the source lines
+@test "test1.6" {
+  $RUN_TEST acclint --format sarif --sourceExcerpts test1.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test1.sarif)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test1.6.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# only the first diagnostics are shown but all are counted
+@test "test1.7" {
+  $RUN_TEST acclint --max-diagnostics 2 --summary test1.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test1.7.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test1.7.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# only one trailing text warning is shown
+@test "test1.8" {
+  $RUN_TEST acclint --max-trailing-text 1 test1.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test1.8.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test1.8.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# only the first duplicate vertices are shown but all are counted
+@test "test2.1" {
+  $RUN_TEST acclint -Wno-warnings -Wduplicate-vertices --max-duplicate-vertices 1 test2.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test2.1.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test2.1.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# and for the summary
+@test "test2.2" {
+  $RUN_TEST acclint -Wno-warnings -Wduplicate-vertices --max-duplicate-vertices=1 --summary test2.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test2.2.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test2.2.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# and for the total when the limit is for all checks
+@test "test2.3" {
+  $RUN_TEST acclint -Wno-warnings -Wduplicate-vertices --max-diagnostics 1 test2.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test2.3.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test2.3.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# written after the error
+@test "test3.1" {
+  $RUN_TEST acclint --flushDiagnostics error test3.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test3.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test3.1.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# an error is known without looking for it in the JSON
+@test "test3.2" {
+  $RUN_TEST acclint --flushDiagnostics error --format jsonl test3.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test3.jsonl)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test3.2.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# invalid UTF-8 is replaced so the JSON is still valid
+@test "test4.1" {
+  $RUN_TEST acclint --format jsonl --sourceExcerpts test4.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test4.jsonl)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test4.1.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# duplicate triangles after the limit are still counted for the total
+@test "test5.1" {
+  $RUN_TEST acclint -Wno-warnings -Wduplicate-triangles --max-diagnostics 1 test5.acc
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test5.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test5.1.output
+  fi
+  [ "$actual" = "$expected" ]
+}
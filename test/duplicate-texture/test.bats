@@ -80,4 +80,16 @@ setup_file() {
   [ "$actual" = "$expected" ]
 }
 
+# textures with the same hash are also compared byte by byte
+@test "test1.7" {
+  $RUN_TEST acclint --compareTextures test1.ac -T textures
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test1.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test1.7.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
 ################################################################################
\ No newline at end of file
@@ -168,3 +168,20 @@ setup_file() {
 }
 
 ################################################################################
+
+# --stats counts the vertex pairs compared and the duplicates found
+@test "test5" {
+  $RUN_TEST acclint --stats -Wno-warnings -Wduplicate-vertices test1.ac
+  [ "$status" -eq 0 ]
+  echo "$output" | grep -q '^duplicate-vertices$'
+  echo "$output" | grep -q '^  vertex pairs  *15$'
+  echo "$output" | grep -q '^  duplicates  *1$'
+}
+
+# only the pairs compared before stopping at the limit are counted
+@test "test6" {
+  $RUN_TEST acclint --stats --format jsonl --max-duplicate-vertices 1 -Wno-warnings -Wduplicate-vertices test1.ac
+  [ "$status" -eq 0 ]
+  echo "$output" | grep -q '^  vertex pairs  *3$'
+  echo "$output" | grep -q '^  duplicates  *1$'
+}
@@ -147,3 +147,31 @@ setup_file() {
 }
 
 ################################################################################
+
+# the surface with the invalid index keeps it when the unused material is
+# removed instead of being looked up past the end of the new indexes
+@test "test3.1" {
+  $RUN_TEST acclint test3.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test3.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test3.1.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+@test "test3.2" {
+  $RUN_TEST acclint -Wno-errors -Wno-warnings test3.ac -o test3.output.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test3.2.output
+  fi
+  [ "$output" = "" ]
+  actual="$(tr -d '\r' < test3.output.ac)"
+  expected="$(tr -d '\r' < test3.result.ac)"
+  [ "$actual" = "$expected" ]
+  rm test3.output.ac
+}
+
+################################################################################
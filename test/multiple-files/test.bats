@@ -0,0 +1,63 @@
+#!/usr/bin/env bats
+
+setup() {
+    if [[ "$(uname)" == "Linux" ]]; then
+        export RUN_TEST="run valgrind --leak-check=full --error-exitcode=1 --quiet"
+    else
+        export RUN_TEST="run"
+    fi
+}
+
+# Delete any *.output debug files left over from a previous run before
+# running any tests in this file.
+setup_file() {
+    rm -f ./*.output
+}
+
+################################################################################
+# Multiple input files are checked in parallel but the output of each file
+# must still be shown in one piece and in the order the files were given.
+################################################################################
+
+@test "test1" {
+  $RUN_TEST acclint test1.ac test2.ac test3.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test1.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test1.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# the summary is for all the files combined
+@test "test2" {
+  $RUN_TEST acclint -j 3 --summary test1.ac test2.ac test3.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test2.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test2.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# one file that can't be read fails the whole run
+@test "test3" {
+  $RUN_TEST acclint -j 2 test1.ac missing.ac test2.ac
+  [ "$status" -ne 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test3.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test3.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# there is nowhere to put more than one output file
+@test "test4" {
+  $RUN_TEST acclint test1.ac test2.ac -o test4.output.ac
+  [ "$status" -ne 0 ]
+  [ "$(echo "${lines[0]}" | tr -d '\r')" = "Multiple input files not supported with -o: test2.ac" ]
+  [ ! -f test4.output.ac ]
+}
@@ -199,3 +199,16 @@ setup_file() {
 }
 
 ################################################################################
+
+# --stats shows where the triangle pairs were decided
+@test "test9" {
+  $RUN_TEST acclint --stats -Wno-warnings -Woverlapping-2-sided-surface test1.ac
+  [ "$status" -eq 0 ]
+  echo "$output" | grep -q '^overlapping-2-sided-surface$'
+  echo "$output" | grep -q '^  triangle pairs  *5$'
+  echo "$output" | grep -q '^  shared vertex shortcuts  *2$'
+  echo "$output" | grep -q '^  TriangleIntersects calls  *3$'
+  echo "$output" | grep -q '^  pointInCoplanarTriangle fallbacks  *3$'
+}
+
+################################################################################
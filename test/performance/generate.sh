@@ -0,0 +1,63 @@
+#!/usr/bin/env bash
+
+# Writes an AC3D file with objects poly objects of vertices vertices each to
+# stdout. Every 3 vertices are a triangle and percent of the vertices are
+# copies of an earlier vertex in the same object. The file only depends on
+# the arguments, the random numbers are made here rather than by awk.
+#
+# Usage: generate.sh objects vertices [percent duplicates] [seed]
+
+objects=${1:?objects}
+vertices=${2:?vertices}
+duplicates=${3:-5}
+seed=${4:-1}
+
+awk -v objects="$objects" -v vertices="$vertices" -v duplicates="$duplicates" -v seed="$seed" '
+# Park-Miller minimal standard generator, exact in the doubles awk uses
+function random() {
+    state = (16807 * state) % 2147483647
+    return state
+}
+
+BEGIN {
+    state = seed % 2147483646 + 1
+    vertices -= vertices % 3
+    grid = int(sqrt(objects))
+    if (grid < 1)
+        grid = 1
+
+    print "AC3Db"
+    print "MATERIAL \"\" rgb 1 1 1  amb 0.2 0.2 0.2  emis 0 0 0  spec 0.5 0.5 0.5  shi 10  trans 0"
+    print "OBJECT world"
+    print "kids " objects
+
+    for (object = 0; object < objects; object++) {
+        x0 = (object % grid) * 100
+        z0 = int(object / grid) * 100
+
+        print "OBJECT poly"
+        print "name \"poly" object "\""
+        print "numvert " vertices
+
+        for (i = 0; i < vertices; i++) {
+            if (i > 0 && random() % 100 < duplicates)
+                line[i] = line[random() % i]
+            else
+                line[i] = (x0 + i % 64) " " (random() % 1000) / 100 " " (z0 + int(i / 64))
+            print line[i]
+        }
+
+        print "numsurf " vertices / 3
+
+        for (i = 0; i < vertices; i += 3) {
+            print "SURF 0x10"
+            print "mat 0"
+            print "refs 3"
+            print i " 0 0"
+            print i + 1 " 0 0"
+            print i + 2 " 0 0"
+        }
+
+        print "kids 0"
+    }
+}'
@@ -0,0 +1,158 @@
+#!/usr/bin/env bats
+
+# Catches changes that make reading, checking, cleaning or writing scale
+# worse than they should, like a loop over the objects becoming quadratic.
+# The same files are generated every time, each operation is timed at two
+# sizes with --showTimes and the time is fitted to size^exponent. The
+# exponent must not be more than the one declared for that operation plus
+# PERF_EXPONENT_TOLERANCE. This doesn't depend on how fast the machine is.
+#
+# With PERF_BASELINE=1 the times and peak memory of the larger size are
+# also compared with baseline.txt, which was made with a Release build on
+# one machine, so this is only meaningful for a Release build on a similar
+# one. They must not be more than PERF_TIME_TOLERANCE and
+# PERF_MEMORY_TOLERANCE times the baseline. PERF_UPDATE_BASELINE=1 writes
+# the new values to baseline.txt instead.
+#
+# Not run under valgrind, which would change the times.
+
+PERF_EXPONENT_TOLERANCE=${PERF_EXPONENT_TOLERANCE:-0.5}
+PERF_TIME_TOLERANCE=${PERF_TIME_TOLERANCE:-3}
+PERF_MEMORY_TOLERANCE=${PERF_MEMORY_TOLERANCE:-1.5}
+# times shorter than this are too noisy to fit
+PERF_MIN_MS=${PERF_MIN_MS:-20}
+
+# the sizes, the larger is 4 times the smaller
+OBJECTS_SMALL=500
+OBJECTS_LARGE=2000
+VERTICES_SMALL=600
+VERTICES_LARGE=2400
+
+# Delete any files left over from a previous run and generate the inputs
+# before running any tests in this file.
+setup_file() {
+    rm -f ./*.output ./*.perf.ac
+    bash generate.sh "$OBJECTS_SMALL" 64 > objects-small.perf.ac
+    bash generate.sh "$OBJECTS_LARGE" 64 > objects-large.perf.ac
+    bash generate.sh 40 "$VERTICES_SMALL" > vertices-small.perf.ac
+    bash generate.sh 40 "$VERTICES_LARGE" > vertices-large.perf.ac
+}
+
+teardown_file() {
+    rm -f ./*.perf.ac
+}
+
+################################################################################
+
+# the total ms of a row of the --showTimes table wherever it was called from
+profileTime() {
+    echo "$1" | awk -v name="$2" '$1 == name && NF == 5 { total += $3 } END { printf "%.3f\n", total }'
+}
+
+# the largest peak memory of the --memory-report reports
+peakMemory() {
+    echo "$1" | sed -n 's/.*peak memory: \([0-9]*\) bytes$/\1/p' | sort -n | tail -n 1
+}
+
+# Fits time = c * size^exponent to the two times and fails when the
+# exponent is more than declared.
+#
+# checkScaling name declared small_ms large_ms small_size large_size
+checkScaling() {
+    local name=$1 declared=$2 small=$3 large=$4 small_size=$5 large_size=$6
+
+    echo "$name: $small ms at $small_size, $large ms at $large_size"
+
+    if awk -v large="$large" -v min="$PERF_MIN_MS" 'BEGIN { exit !(large < min) }'; then
+        echo "$name: too fast to measure"
+        return 0
+    fi
+
+    awk -v name="$name" -v declared="$declared" -v tolerance="$PERF_EXPONENT_TOLERANCE" \
+        -v small="$small" -v large="$large" -v small_size="$small_size" -v large_size="$large_size" 'BEGIN {
+        if (small < 0.001)
+            small = 0.001
+        exponent = log(large / small) / log(large_size / small_size)
+        printf "%s: exponent %.2f declared %s\n", name, exponent, declared
+        exit !(exponent <= declared + tolerance)
+    }'
+}
+
+# Compares with the line for name in baseline.txt or replaces it. Does
+# nothing unless asked to.
+#
+# checkBaseline name ms peak_bytes
+checkBaseline() {
+    local name=$1 ms=$2 peak=$3
+
+    if [ "${PERF_UPDATE_BASELINE:-0}" = "1" ]; then
+        grep -v "^$name " baseline.txt > baseline.txt.output || true
+        echo "$name $ms $peak" >> baseline.txt.output
+        (grep '^#' baseline.txt.output; grep -v '^#' baseline.txt.output | sort) > baseline.txt
+        rm -f baseline.txt.output
+        return 0
+    fi
+
+    if [ "${PERF_BASELINE:-0}" != "1" ]; then
+        return 0
+    fi
+
+    awk -v name="$name" -v ms="$ms" -v peak="$peak" -v time_tolerance="$PERF_TIME_TOLERANCE" \
+        -v memory_tolerance="$PERF_MEMORY_TOLERANCE" -v min="$PERF_MIN_MS" '$1 == name {
+        found = 1
+        printf "%s: %s ms baseline %s ms, %s bytes baseline %s bytes\n", name, ms, $2, peak, $3
+        if (ms > $2 * time_tolerance && ms >= min)
+            failed = 1
+        if (peak != "" && peak > $3 * memory_tolerance)
+            failed = 1
+    }
+    END { exit !(found && !failed) }' baseline.txt
+}
+
+# run acclint on a file, cleaning it and writing it, and keep the output
+measure() {
+    run acclint --quiet -Wno-warnings -Wduplicate-vertices --showTimes --memory-report "$1" -o "$2"
+    rm -f "$2"
+}
+
+################################################################################
+
+# reading, the duplicate vertices check, cleaning the vertices and writing
+# are linear in the number of objects
+@test "objects" {
+  measure objects-small.perf.ac objects-small.output.ac
+  [ "$status" -eq 0 ]
+  small="$output"
+  measure objects-large.perf.ac objects-large.output.ac
+  [ "$status" -eq 0 ]
+  large="$output"
+
+  failed=0
+  for name in read checkDuplicateVertices cleanVertices write; do
+    checkScaling "$name" 1 "$(profileTime "$small" $name)" "$(profileTime "$large" $name)" "$OBJECTS_SMALL" "$OBJECTS_LARGE" || failed=1
+    checkBaseline "objects-$name" "$(profileTime "$large" $name)" "$(peakMemory "$large")" || failed=1
+  done
+  [ "$failed" -eq 0 ]
+}
+
+# Finding duplicate vertices compares every pair of vertices of an object
+# because they are equal within a tolerance so they can't be sorted or
+# hashed. Writing is still linear.
+@test "vertices" {
+  measure vertices-small.perf.ac vertices-small.output.ac
+  [ "$status" -eq 0 ]
+  small="$output"
+  measure vertices-large.perf.ac vertices-large.output.ac
+  [ "$status" -eq 0 ]
+  large="$output"
+
+  failed=0
+  for name in checkDuplicateVertices cleanVertices; do
+    checkScaling "$name" 2 "$(profileTime "$small" $name)" "$(profileTime "$large" $name)" "$VERTICES_SMALL" "$VERTICES_LARGE" || failed=1
+    checkBaseline "vertices-$name" "$(profileTime "$large" $name)" "$(peakMemory "$large")" || failed=1
+  done
+  for name in write; do
+    checkScaling "$name" 1 "$(profileTime "$small" $name)" "$(profileTime "$large" $name)" "$VERTICES_SMALL" "$VERTICES_LARGE" || failed=1
+  done
+  [ "$failed" -eq 0 ]
+}
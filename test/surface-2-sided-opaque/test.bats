@@ -45,6 +45,18 @@ setup_file() {
   [ "$actual" = "$expected" ]
 }
 
+# the texture is decoded on another thread while the file is read
+@test "test1.4" {
+  $RUN_TEST acclint -j 4 -Wno-warnings -Wsurface-2-sided-opaque test1.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test1.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test1.4.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
 ################################################################################
 
 @test "test2.1" {
@@ -136,4 +148,172 @@ setup_file() {
     echo "$output" > test4.3.output
   fi
   [ "$actual" = "$expected" ]
-}
\ No newline at end of file
+}
+
+################################################################################
+
+@test "test5.1" {
+  $RUN_TEST acclint test5.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test5.1.output
+  fi
+  [ "$output" = "" ]
+}
+
+@test "test5.2" {
+  $RUN_TEST acclint -Wno-warnings test5.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test5.2.output
+  fi
+  [ "$output" = "" ]
+}
+
+@test "test5.3" {
+  $RUN_TEST acclint -Wno-warnings -Wsurface-2-sided-opaque test5.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test5.3.output
+  fi
+  [ "$output" = "" ]
+}
+
+################################################################################
+
+@test "test6.1" {
+  $RUN_TEST acclint test6.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test6.1.output
+  fi
+  [ "$output" = "" ]
+}
+
+@test "test6.2" {
+  $RUN_TEST acclint -Wno-warnings test6.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test6.2.output
+  fi
+  [ "$output" = "" ]
+}
+
+@test "test6.3" {
+  $RUN_TEST acclint -Wno-warnings -Wsurface-2-sided-opaque test6.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test6.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test6.3.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+################################################################################
+
+@test "test7.1" {
+  $RUN_TEST acclint test7.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test7.1.output
+  fi
+  [ "$output" = "" ]
+}
+
+@test "test7.2" {
+  $RUN_TEST acclint -Wno-warnings test7.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test7.2.output
+  fi
+  [ "$output" = "" ]
+}
+
+@test "test7.3" {
+  $RUN_TEST acclint -Wno-warnings -Wsurface-2-sided-opaque test7.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test7.3.output
+  fi
+  [ "$output" = "" ]
+}
+
+################################################################################
+
+@test "test8.1" {
+  $RUN_TEST acclint test8.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test8.1.output
+  fi
+  [ "$output" = "" ]
+}
+
+@test "test8.2" {
+  $RUN_TEST acclint -Wno-warnings test8.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test8.2.output
+  fi
+  [ "$output" = "" ]
+}
+
+@test "test8.3" {
+  $RUN_TEST acclint -Wno-warnings -Wsurface-2-sided-opaque test8.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test8.3.output
+  fi
+  [ "$output" = "" ]
+}
+################################################################################
+
+# libpng's warning about the texture's sRGB profile isn't written to stderr
+# in the middle of the diagnostics whether or not it's decoded on a thread
+@test "test9.1" {
+  $RUN_TEST acclint --format jsonl -Wno-warnings -Wsurface-2-sided-opaque test9.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test9.jsonl)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test9.1.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+@test "test9.2" {
+  $RUN_TEST acclint -j 4 --format jsonl -Wno-warnings -Wsurface-2-sided-opaque test9.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test9.jsonl)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test9.2.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+################################################################################
+
+# a libpng error is reported with the texture like the other problems reading it
+@test "test10.1" {
+  $RUN_TEST acclint -Wno-warnings -Wsurface-2-sided-opaque test10.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test10.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test10.1.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+@test "test10.2" {
+  $RUN_TEST acclint -j 4 --format jsonl -Wno-warnings -Wsurface-2-sided-opaque test10.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test10.jsonl)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test10.2.output
+  fi
+  [ "$actual" = "$expected" ]
+}
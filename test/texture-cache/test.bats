@@ -0,0 +1,97 @@
+#!/usr/bin/env bats
+
+setup() {
+    if [[ "$(uname)" == "Linux" ]]; then
+        export RUN_TEST="run valgrind --leak-check=full --error-exitcode=1 --quiet"
+    else
+        export RUN_TEST="run"
+    fi
+}
+
+# Delete any *.output debug files and caches left over from a previous run
+# before running any tests in this file.
+setup_file() {
+    rm -f ./*.output ./*.cache ./*.cache.lock ./parallel*
+}
+
+# The caches and the files made for test1.4 are only needed while the tests run.
+teardown_file() {
+    rm -f ./*.cache ./*.cache.lock ./parallel*
+}
+
+################################################################################
+
+# the cache is created and gives the same result as decoding the texture
+@test "test1.1" {
+  rm -f test1.1.cache
+  $RUN_TEST acclint -Wno-warnings -Wsurface-2-sided-opaque --textureCache test1.1.cache test1.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test1.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test1.1.output
+  fi
+  [ "$actual" = "$expected" ]
+  [ "$(wc -l < test1.1.cache)" -eq 2 ]
+  grep -q 'test.png" [0-9]* -\?[0-9]* 1 0 128 128 3 8 0 0$' test1.1.cache
+}
+
+# the texture isn't decoded again when the cache is used
+@test "test1.2" {
+  rm -f test1.2.cache
+  run acclint -Wno-warnings -Wsurface-2-sided-opaque --textureCache test1.2.cache test1.ac
+  [ "$status" -eq 0 ]
+  sed -i 's/ 1 0 128 128 3 8 0 0$/ 1 1 128 128 3 8 0 0/' test1.2.cache
+  $RUN_TEST acclint -Wno-warnings -Wsurface-2-sided-opaque --textureCache test1.2.cache test1.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test1.2.output
+  fi
+  [ "$output" = "" ]
+}
+
+# a texture that changed since it was cached is decoded again
+@test "test1.3" {
+  rm -f test1.3.cache
+  run acclint -Wno-warnings -Wsurface-2-sided-opaque --textureCache test1.3.cache test1.ac
+  [ "$status" -eq 0 ]
+  sed -i 's/" [0-9]* \(-\?[0-9]*\) 1 0 128 128 3 8 0 0$/" 1 \1 1 1 128 128 3 8 0 0/' test1.3.cache
+  $RUN_TEST acclint -Wno-warnings -Wsurface-2-sided-opaque --textureCache test1.3.cache test1.ac
+  [ "$status" -eq 0 ]
+  actual="$(echo "$output" | tr -d '\r')"
+  expected="$(tr -d '\r' < test1.result)"
+  if [ "$actual" != "$expected" ]; then
+    echo "$output" > test1.3.output
+  fi
+  [ "$actual" = "$expected" ]
+}
+
+# processes saving the same cache at once keep each other's entries
+@test "test1.4" {
+  rm -f test1.4.cache
+  for i in 1 2 3 4 5 6 7 8; do
+    cp test.png parallel$i.png
+    sed "s/test.png/parallel$i.png/" test1.ac > parallel$i.ac
+  done
+  for i in 1 2 3 4 5 6 7 8; do
+    acclint -Wno-warnings -Wsurface-2-sided-opaque --textureCache test1.4.cache parallel$i.ac > /dev/null 2>&1 &
+  done
+  wait
+  run grep -c "parallel[1-8].png" test1.4.cache
+  [ "$output" = "8" ]
+}
+
+################################################################################
+
+# textures of objects without a 2 sided surface aren't decoded, or cached,
+# when there are threads to decode them while reading
+@test "test2.1" {
+  rm -f test2.1.cache
+  $RUN_TEST acclint -j 4 -Wno-warnings -Wsurface-2-sided-opaque --textureCache test2.1.cache test2.ac
+  [ "$status" -eq 0 ]
+  if [ "$output" != "" ]; then
+    echo "$output" > test2.1.output
+  fi
+  [ "$output" = "" ]
+  [ ! -e test2.1.cache ]
+}
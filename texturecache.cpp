@@ -0,0 +1,348 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#include "texturecache.h"
+
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// change this when the meaning of an entry changes so old caches are ignored
+const std::string header = "acclint texture cache 2";
+
+// An exclusive lock on a file next to the cache, held while the cache is
+// read, merged and replaced so another process doing the same waits rather
+// than replacing it with a file that doesn't have this one's entries.
+// The lock file is left behind because removing it would let a process
+// that already opened it lock a file nobody else can see.
+class FileLock
+{
+public:
+    explicit FileLock(const std::string &file)
+    {
+#ifdef _WIN32
+        m_handle = CreateFileA(file.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                               nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_handle == INVALID_HANDLE_VALUE)
+            return;
+
+        OVERLAPPED overlapped = {};
+        m_locked = LockFileEx(m_handle, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped) != 0;
+#else
+        m_fd = open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+        if (m_fd == -1)
+            return;
+
+        int result;
+        do
+            result = flock(m_fd, LOCK_EX);
+        while (result == -1 && errno == EINTR);
+        m_locked = result == 0;
+#endif
+    }
+
+    ~FileLock()
+    {
+#ifdef _WIN32
+        if (m_handle == INVALID_HANDLE_VALUE)
+            return;
+
+        if (m_locked)
+        {
+            OVERLAPPED overlapped = {};
+            UnlockFileEx(m_handle, 0, MAXDWORD, MAXDWORD, &overlapped);
+        }
+        CloseHandle(m_handle);
+#else
+        // closing the file releases the lock
+        if (m_fd != -1)
+            close(m_fd);
+#endif
+    }
+
+    FileLock(const FileLock &) = delete;
+    FileLock &operator=(const FileLock &) = delete;
+
+    bool locked() const
+    {
+        return m_locked;
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE m_handle = INVALID_HANDLE_VALUE;
+#else
+    int    m_fd = -1;
+#endif
+    bool   m_locked = false;
+};
+
+} // namespace
+
+TextureCache::~TextureCache()
+{
+    if (!save())
+        std::cerr << "Couldn't save texture cache: " << m_file << std::endl;
+}
+
+bool TextureCache::getKey(const std::string &path, std::string &canonical, Entry &entry)
+{
+    std::error_code ec;
+
+    canonical = std::filesystem::canonical(path, ec).generic_string();
+    if (ec)
+        return false;
+
+    entry.size = std::filesystem::file_size(canonical, ec);
+    if (ec)
+        return false;
+
+    const std::filesystem::file_time_type time = std::filesystem::last_write_time(canonical, ec);
+    if (ec)
+        return false;
+
+    entry.time = static_cast<std::int64_t>(time.time_since_epoch().count());
+
+    return true;
+}
+
+void TextureCache::read(const std::string &file, std::map<std::string, Entry> &entries)
+{
+    std::ifstream in(file);
+    std::string line;
+
+    if (!std::getline(in, line) || line != header)
+        return;
+
+    // a bad line is skipped because the texture will just be decoded again
+    while (std::getline(in, line))
+    {
+        std::istringstream iss(line);
+        std::string path;
+        Entry entry;
+
+        iss >> std::quoted(path) >> entry.size >> entry.time >> entry.decoded >> entry.info.transparent
+            >> entry.info.width >> entry.info.height >> entry.info.channels >> entry.info.bit_depth
+            >> entry.hashed >> std::hex >> entry.hash;
+
+        if (iss && !path.empty())
+            entries[path] = entry;
+    }
+}
+
+void TextureCache::load(const std::string &file)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_file = file;
+    m_entries.clear();
+    m_modified = false;
+
+    read(m_file, m_entries);
+}
+
+bool TextureCache::save()
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_file.empty() || !m_modified)
+        return true;
+
+    // without the lock another process could replace the file between
+    // reading and renaming it and what it added would be lost
+    const FileLock file_lock(m_file + ".lock");
+
+    if (!file_lock.locked())
+        return false;
+
+    // keep what other processes added since it was loaded
+    std::map<std::string, Entry> entries;
+
+    read(m_file, entries);
+
+    for (const auto &[path, entry] : m_entries)
+    {
+        const std::map<std::string, Entry>::iterator it = entries.find(path);
+
+        if (it == entries.end() || it->second.size != entry.size || it->second.time != entry.time)
+        {
+            entries[path] = entry;
+            continue;
+        }
+
+        // the same file so keep what either process learned about it
+        if (entry.decoded)
+        {
+            it->second.decoded = true;
+            it->second.info = entry.info;
+        }
+
+        if (entry.hashed)
+        {
+            it->second.hashed = true;
+            it->second.hash = entry.hash;
+        }
+    }
+
+    std::random_device device;
+    std::ostringstream name;
+    name << m_file << "." << std::hex << device() << device() << ".tmp";
+    const std::string temp = name.str();
+
+    {
+        std::ofstream out(temp);
+
+        out << header << '\n';
+
+        for (const auto &[path, entry] : entries)
+        {
+            out << std::quoted(path) << ' ' << entry.size << ' ' << entry.time << ' ' << entry.decoded
+                << ' ' << entry.info.transparent << ' ' << entry.info.width << ' ' << entry.info.height
+                << ' ' << entry.info.channels << ' ' << entry.info.bit_depth << ' ' << entry.hashed
+                << ' ' << std::hex << entry.hash << std::dec << '\n';
+        }
+
+        out.close();
+
+        if (!out)
+        {
+            std::error_code ec;
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp, m_file, ec);
+
+    if (ec)
+    {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+
+    m_entries = std::move(entries);
+    m_modified = false;
+
+    return true;
+}
+
+// must be called with m_mutex locked
+TextureCache::Entry *TextureCache::findEntry(const std::string &path)
+{
+    std::string canonical;
+    Entry key;
+
+    if (!getKey(path, canonical, key))
+        return nullptr;
+
+    const std::map<std::string, Entry>::iterator it = m_entries.find(canonical);
+
+    if (it == m_entries.end() || it->second.size != key.size || it->second.time != key.time)
+        return nullptr;
+
+    return &it->second;
+}
+
+// must be called with m_mutex locked
+TextureCache::Entry *TextureCache::insertEntry(const std::string &path)
+{
+    std::string canonical;
+    Entry key;
+
+    if (!getKey(path, canonical, key))
+        return nullptr;
+
+    Entry &entry = m_entries[canonical];
+
+    // forget everything known about an older version of the file
+    if (entry.size != key.size || entry.time != key.time)
+        entry = key;
+
+    m_modified = true;
+
+    return &entry;
+}
+
+bool TextureCache::find(const std::string &path, Info &info)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    const Entry *entry = findEntry(path);
+
+    if (entry == nullptr || !entry->decoded)
+        return false;
+
+    info = entry->info;
+
+    return true;
+}
+
+void TextureCache::insert(const std::string &path, const Info &info)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    Entry *entry = insertEntry(path);
+
+    if (entry == nullptr)
+        return;
+
+    entry->decoded = true;
+    entry->info = info;
+}
+
+bool TextureCache::findHash(const std::string &path, std::uint64_t &hash)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    const Entry *entry = findEntry(path);
+
+    if (entry == nullptr || !entry->hashed)
+        return false;
+
+    hash = entry->hash;
+
+    return true;
+}
+
+void TextureCache::insertHash(const std::string &path, std::uint64_t hash)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    Entry *entry = insertEntry(path);
+
+    if (entry == nullptr)
+        return;
+
+    entry->hashed = true;
+    entry->hash = hash;
+}
@@ -0,0 +1,90 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Remembers what was learned from decoding and hashing textures between
+// runs so the same shared textures don't have to be read every time
+// acclint runs.
+//
+// Entries are keyed by the canonical path of the texture and are only used
+// while the size and modification time of the file are unchanged.
+// The cache is read by load() and written back by save() (or when it is
+// destroyed) if anything was added. save() holds a lock on the file with
+// ".lock" appended while it merges in what other acclint processes saved in
+// the mean time and replaces the file with a rename, so processes saving at
+// once keep each other's entries and a process loading it never sees a
+// partially written file.
+class TextureCache
+{
+public:
+    struct Info
+    {
+        bool          transparent = false;
+        std::uint32_t width = 0;
+        std::uint32_t height = 0;
+        int           channels = 0;
+        int           bit_depth = 0;
+    };
+
+    TextureCache() = default;
+    ~TextureCache();
+
+    TextureCache(const TextureCache &) = delete;
+    TextureCache &operator=(const TextureCache &) = delete;
+
+    void load(const std::string &file);
+    bool save();
+
+    bool find(const std::string &path, Info &info);
+    void insert(const std::string &path, const Info &info);
+
+    bool findHash(const std::string &path, std::uint64_t &hash);
+    void insertHash(const std::string &path, std::uint64_t hash);
+
+private:
+    struct Entry
+    {
+        std::uintmax_t size = 0;
+        std::int64_t   time = 0;
+        bool           decoded = false;
+        Info           info;
+        bool           hashed = false;
+        std::uint64_t  hash = 0;
+    };
+
+    static bool getKey(const std::string &path, std::string &canonical, Entry &entry);
+    Entry *findEntry(const std::string &path);
+    Entry *insertEntry(const std::string &path);
+    static void read(const std::string &file, std::map<std::string, Entry> &entries);
+
+    std::string                  m_file;
+    std::map<std::string, Entry> m_entries;
+    bool                         m_modified = false;
+    std::mutex                   m_mutex;
+};
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#include "threadpool.h"
+
+namespace {
+
+// the pool and queue of the worker running on this thread
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned int threads) : m_threads(threads < 1 ? 1 : threads)
+{
+    const size_t workers = m_threads - 1;
+
+    for (size_t i = 0; i < workers + 1; ++i)
+        m_queues.push_back(std::make_unique<Queue>());
+
+    for (size_t i = 0; i < workers; ++i)
+        m_workers.emplace_back(&ThreadPool::worker, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_condition.notify_all();
+
+    for (auto &worker : m_workers)
+        worker.join();
+}
+
+size_t ThreadPool::queueIndex() const
+{
+    if (current_pool == this)
+        return current_index;
+
+    return m_queues.size() - 1;
+}
+
+void ThreadPool::run(TaskGroup &group, std::function<void()> task)
+{
+    group.m_pending++;
+
+    size_t index = queueIndex();
+
+    // spread tasks from outside the pool over all the queues so the
+    // workers don't all have to steal them from the same queue
+    if (index == m_queues.size() - 1)
+        index = m_next++ % m_queues.size();
+
+    {
+        const std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back({ std::move(task), &group });
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_generation++;
+    }
+
+    m_condition.notify_all();
+}
+
+bool ThreadPool::find(Task &task, size_t index, const TaskGroup *group)
+{
+    // newest task from our own queue first because it's most likely to
+    // still be in the cache, then the oldest task from everyone else
+    for (size_t i = 0; i < m_queues.size(); ++i)
+    {
+        Queue &queue = *m_queues[(index + i) % m_queues.size()];
+        const std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.tasks.empty())
+            continue;
+
+        if (i == 0)
+        {
+            for (auto it = queue.tasks.rbegin(); it != queue.tasks.rend(); ++it)
+            {
+                if (group == nullptr || it->group == group)
+                {
+                    task = std::move(*it);
+                    queue.tasks.erase(std::next(it).base());
+                    return true;
+                }
+            }
+        }
+        else
+        {
+            for (auto it = queue.tasks.begin(); it != queue.tasks.end(); ++it)
+            {
+                if (group == nullptr || it->group == group)
+                {
+                    task = std::move(*it);
+                    queue.tasks.erase(it);
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::execute(Task &task)
+{
+    task.function();
+
+    // the group may be destroyed by its waiter as soon as this reaches 0
+    if (--task.group->m_pending == 0)
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_condition.notify_all();
+    }
+}
+
+void ThreadPool::worker(size_t index)
+{
+    current_pool = this;
+    current_index = index;
+
+    while (true)
+    {
+        size_t generation;
+
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stop)
+                return;
+            generation = m_generation;
+        }
+
+        Task task;
+
+        if (find(task, index, nullptr))
+        {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this, generation] { return m_stop || m_generation != generation; });
+    }
+}
+
+void ThreadPool::wait(TaskGroup &group)
+{
+    const size_t index = queueIndex();
+
+    // only help with tasks from this group so nested waits can't pile
+    // unrelated work (like other input files) onto this thread's stack
+    while (group.m_pending != 0)
+    {
+        size_t generation;
+
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            generation = m_generation;
+        }
+
+        Task task;
+
+        if (find(task, index, &group))
+        {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this, &group, generation] { return group.m_pending == 0 || m_generation != generation; });
+    }
+}
+
+size_t TaskGraph::add(std::function<void()> task)
+{
+    m_nodes.push_back(std::make_unique<Node>());
+    m_nodes.back()->task = std::move(task);
+
+    return m_nodes.size() - 1;
+}
+
+void TaskGraph::precede(size_t before, size_t after)
+{
+    m_nodes[before]->successors.push_back(after);
+    m_nodes[after]->predecessors++;
+}
+
+void TaskGraph::start(ThreadPool &pool, ThreadPool::TaskGroup &group, size_t index)
+{
+    pool.run(group, [this, &pool, &group, index]
+    {
+        const Node &node = *m_nodes[index];
+
+        node.task();
+
+        // the group can't finish while this task is still running so
+        // successors started here are always waited for
+        for (const size_t successor : node.successors)
+        {
+            if (--m_nodes[successor]->remaining == 0)
+                start(pool, group, successor);
+        }
+    });
+}
+
+void TaskGraph::run(ThreadPool &pool)
+{
+    ThreadPool::TaskGroup group;
+
+    for (auto &node : m_nodes)
+        node->remaining = node->predecessors;
+
+    for (size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        if (m_nodes[i]->predecessors == 0)
+            start(pool, group, i);
+    }
+
+    pool.wait(group);
+}
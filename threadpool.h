@@ -0,0 +1,161 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A work stealing thread pool shared by everything that runs in parallel
+// (multiple input files and the parallel parts of a single file) so the
+// number of running threads never exceeds what was asked for with -j.
+//
+// The thread calling wait() counts as one of the threads: it runs tasks
+// from the group it is waiting for instead of blocking, so a pool created
+// with 1 thread has no worker threads and runs everything on the caller.
+// Waiting for a group from inside a task is allowed for the same reason.
+class ThreadPool
+{
+public:
+    class TaskGroup
+    {
+        friend class ThreadPool;
+
+        std::atomic<size_t> m_pending = 0;
+    };
+
+    explicit ThreadPool(unsigned int threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned int threads() const
+    {
+        return m_threads;
+    }
+
+    void run(TaskGroup &group, std::function<void()> task);
+    void wait(TaskGroup &group);
+
+    // Call function(i) for every i from begin to end - 1 and wait until
+    // they are all done. The indexes are handed out in chunks of grain
+    // indexes (0 picks a size that gives every thread several chunks to
+    // balance uneven work).
+    template <typename Function>
+    void parallelFor(size_t begin, size_t end, const Function &function, size_t grain = 0)
+    {
+        if (begin >= end)
+            return;
+
+        if (m_threads == 1)
+        {
+            for (size_t i = begin; i < end; ++i)
+                function(i);
+            return;
+        }
+
+        if (grain == 0)
+            grain = std::max<size_t>(1, (end - begin) / (m_threads * 8));
+
+        TaskGroup group;
+
+        for (size_t first = begin; first < end; first += std::min(grain, end - first))
+        {
+            const size_t last = first + std::min(grain, end - first);
+
+            run(group, [&function, first, last]
+            {
+                for (size_t i = first; i < last; ++i)
+                    function(i);
+            });
+        }
+
+        wait(group);
+    }
+
+private:
+    struct Task
+    {
+        std::function<void()> function;
+        TaskGroup *group = nullptr;
+    };
+
+    // Each worker owns a queue that it pushes to and pops from at the back.
+    // Idle threads steal from the front of the other queues. The last queue
+    // is for tasks submitted by threads that aren't workers of this pool.
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    size_t queueIndex() const;
+    bool find(Task &task, size_t index, const TaskGroup *group);
+    void execute(Task &task);
+    void worker(size_t index);
+
+    unsigned int                        m_threads = 1;
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread>            m_workers;
+    std::atomic<size_t>                 m_next = 0;
+    std::mutex                          m_mutex;
+    std::condition_variable             m_condition;
+    size_t                              m_generation = 0;
+    bool                                m_stop = false;
+};
+
+// A set of tasks where some tasks can't start until others are done.
+// Tasks that don't depend on each other run in parallel.
+class TaskGraph
+{
+public:
+    // returns the id used to refer to the task in precede()
+    size_t add(std::function<void()> task);
+
+    // after doesn't start until before is done
+    void precede(size_t before, size_t after);
+
+    // runs all the tasks and waits until they are all done
+    void run(ThreadPool &pool);
+
+private:
+    struct Node
+    {
+        std::function<void()> task;
+        std::vector<size_t> successors;
+        size_t predecessors = 0;
+        std::atomic<size_t> remaining = 0;
+    };
+
+    void start(ThreadPool &pool, ThreadPool::TaskGroup &group, size_t index);
+
+    std::vector<std::unique_ptr<Node>> m_nodes;
+};
+
+#endif
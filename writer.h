@@ -0,0 +1,143 @@
+/*
+ * acclint - A tool that detects errors in AC3D files.
+ * Copyright (C) 2020-2026 Robert Reif
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <charconv>
+#include <concepts>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Formats AC3D output into a large buffer with std::to_chars instead of
+// formatting every number through an ostream. The buffer is written to
+// the stream in large blocks, or kept in memory when there is no stream.
+//
+// Doubles are written like an ostream with setprecision(12) does (%.12g)
+// so files written are the same as before.
+class Writer
+{
+public:
+    // the buffer is written to the stream when it gets this big
+    static constexpr size_t flush_size = 1024 * 1024;
+
+    Writer() = default;
+
+    explicit Writer(std::ostream &out) : m_out(&out)
+    {
+        m_buffer.reserve(flush_size + 1024);
+    }
+
+    ~Writer()
+    {
+        flush();
+    }
+
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    Writer &operator << (std::string_view text)
+    {
+        m_buffer.append(text);
+        check();
+        return *this;
+    }
+
+    Writer &operator << (char c)
+    {
+        m_buffer.push_back(c);
+        check();
+        return *this;
+    }
+
+    Writer &operator << (double value)
+    {
+        char buffer[32];
+        const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 12);
+        m_buffer.append(buffer, result.ptr);
+        check();
+        return *this;
+    }
+
+    template <std::integral T>
+    Writer &operator << (T value)
+    {
+        char buffer[24];
+        const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        m_buffer.append(buffer, result.ptr);
+        check();
+        return *this;
+    }
+
+    // lower case hexadecimal without a prefix like std::hex
+    Writer &hex(unsigned int value)
+    {
+        char buffer[16];
+        const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value, 16);
+        m_buffer.append(buffer, result.ptr);
+        check();
+        return *this;
+    }
+
+    // Append everything written to a writer without a stream. Large
+    // buffers are written straight to the stream instead of being copied.
+    Writer &operator << (const Writer &writer)
+    {
+        if (m_out != nullptr && writer.m_buffer.size() >= flush_size)
+        {
+            flush();
+            m_out->write(writer.m_buffer.data(), static_cast<std::streamsize>(writer.m_buffer.size()));
+        }
+        else
+        {
+            m_buffer.append(writer.m_buffer);
+            check();
+        }
+        return *this;
+    }
+
+    void flush()
+    {
+        if (m_out != nullptr && !m_buffer.empty())
+        {
+            m_out->write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+            m_buffer.clear();
+        }
+    }
+
+    // everything written so far when there is no stream
+    const std::string &buffer() const
+    {
+        return m_buffer;
+    }
+
+private:
+    void check()
+    {
+        if (m_out != nullptr && m_buffer.size() >= flush_size)
+            flush();
+    }
+
+    std::ostream *m_out = nullptr;
+    std::string   m_buffer;
+};
+
+#endif